@@ -0,0 +1,153 @@
+// iqfit_affinity.cpp
+// /sys topology discovery and thread pinning (sched_setaffinity on Linux).
+
+#include "iqfit_affinity.h"
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstdlib>
+#include <dirent.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+bool parsePinMode(const std::string &text, PinMode &mode) {
+    if (text == "none") mode = PIN_NONE;
+    else if (text == "cores") mode = PIN_CORES;
+    else if (text == "numa") mode = PIN_NUMA;
+    else return false;
+    return true;
+}
+
+// Kernel CPU list format: "0-3,8,10-11"
+static std::vector<int> parseCpuList(const std::string &text) {
+    std::vector<int> cpus;
+    std::istringstream ranges(text);
+    std::string range;
+    while (std::getline(ranges, range, ',')) {
+        if (range.empty() || range[0] < '0' || range[0] > '9') continue;
+        size_t dash = range.find('-');
+        int first = std::atoi(range.c_str());
+        int last = dash == std::string::npos ? first : std::atoi(range.c_str() + dash + 1);
+        for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+static std::string formatCpuList(const std::vector<int> &cpus) {
+    std::string text;
+    for (size_t i = 0; i < cpus.size(); ++i) {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) ++j;
+        if (!text.empty()) text += ",";
+        text += std::to_string(cpus[i]);
+        if (j > i) text += "-" + std::to_string(cpus[j]);
+        i = j;
+    }
+    return text;
+}
+
+// CPUs this process may run on (all online CPUs where affinity is not available)
+static std::vector<int> usableCpus() {
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &allowed)) cpus.push_back(cpu);
+        }
+        return cpus;
+    }
+#endif
+    std::ifstream online("/sys/devices/system/cpu/online");
+    std::string text;
+    if (std::getline(online, text)) cpus = parseCpuList(text);
+    if (cpus.empty()) cpus.push_back(0);
+    return cpus;
+}
+
+NumaTopology discoverTopology(int maxNodes) {
+    NumaTopology topology;
+    std::vector<int> allowed = usableCpus();
+
+    std::vector<int> nodeIds;
+    if (DIR *nodes = opendir("/sys/devices/system/node")) {
+        while (dirent *entry = readdir(nodes)) {
+            std::string name = entry->d_name;
+            if (name.compare(0, 4, "node") == 0 && name.size() > 4 && name[4] >= '0' && name[4] <= '9') {
+                nodeIds.push_back(std::atoi(name.c_str() + 4));
+            }
+        }
+        closedir(nodes);
+    }
+    std::sort(nodeIds.begin(), nodeIds.end());
+    for (int nodeId : nodeIds) {
+        std::ifstream cpuList("/sys/devices/system/node/node" + std::to_string(nodeId) + "/cpulist");
+        std::string text;
+        std::getline(cpuList, text);
+        std::vector<int> cpus;
+        for (int cpu : parseCpuList(text)) {
+            if (std::find(allowed.begin(), allowed.end(), cpu) != allowed.end()) cpus.push_back(cpu);
+        }
+        if (cpus.empty()) continue;
+        topology.nodeIds.push_back(nodeId);
+        topology.nodeCpus.push_back(cpus);
+    }
+    if (topology.nodeIds.empty()) {
+        topology.nodeIds.push_back(0);
+        topology.nodeCpus.push_back(allowed);
+    }
+    if (maxNodes > 0 && (int)topology.nodeIds.size() > maxNodes) {
+        topology.nodeIds.resize(maxNodes);
+        topology.nodeCpus.resize(maxNodes);
+    }
+    return topology;
+}
+
+WorkerPlacement placeWorker(const NumaTopology &topology, PinMode mode, int worker) {
+    WorkerPlacement placement;
+    if (mode == PIN_NONE) return placement;
+    int nodes = topology.nodeIds.size();
+    placement.node = worker % nodes;
+    const std::vector<int> &cpus = topology.nodeCpus[placement.node];
+    if (mode == PIN_CORES) {
+        placement.cpus.push_back(cpus[(worker / nodes) % cpus.size()]);
+    } else {
+        placement.cpus = cpus;
+    }
+    return placement;
+}
+
+bool pinCurrentThread(const WorkerPlacement &placement, std::string &error) {
+    if (placement.node < 0) return true;
+#ifdef __linux__
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (int cpu : placement.cpus) CPU_SET(cpu, &cpus);
+    // pid 0 is the calling thread, not the whole process
+    if (sched_setaffinity(0, sizeof(cpus), &cpus) != 0) {
+        error = "cannot pin to cpus " + formatCpuList(placement.cpus);
+        return false;
+    }
+    return true;
+#else
+    error = "CPU pinning is only supported on Linux";
+    return false;
+#endif
+}
+
+std::string describePlacement(const NumaTopology &topology, const WorkerPlacement &placement) {
+    if (placement.node < 0) return "unpinned";
+    return "node " + std::to_string(topology.nodeIds[placement.node]) +
+           (placement.cpus.size() == 1 ? ", cpu " : ", cpus ") + formatCpuList(placement.cpus);
+}
+
+std::string describeTopology(const NumaTopology &topology) {
+    std::string text = std::to_string(topology.nodeIds.size()) + (topology.nodeIds.size() == 1 ? " NUMA node (" : " NUMA nodes (");
+    for (size_t n = 0; n < topology.nodeIds.size(); ++n) {
+        text += (n ? ", " : "") + std::to_string(topology.nodeIds[n]) + ": " + formatCpuList(topology.nodeCpus[n]);
+    }
+    return text + ")";
+}
@@ -0,0 +1,44 @@
+// iqfit_affinity.h
+// CPU and NUMA placement for ranks and threads. The topology comes from /sys (Linux), limited
+// to the CPUs this process may run on. Workers are spread round-robin over the NUMA nodes, in
+// step with the round-robin unit distribution, and pinned either to one core or to all cores
+// of their node. Memory is placed by first touch: whatever a pinned worker allocates and fills
+// lives on its node, so placement tables should be built after pinning.
+
+#ifndef IQFIT_AFFINITY_H
+#define IQFIT_AFFINITY_H
+
+#include <string>
+#include <vector>
+
+enum PinMode { PIN_NONE, PIN_CORES, PIN_NUMA };
+
+// "none", "cores" or "numa"
+bool parsePinMode(const std::string &text, PinMode &mode);
+
+struct NumaTopology {
+    std::vector<int> nodeIds;                   // as numbered by the system
+    std::vector<std::vector<int>> nodeCpus;     // usable CPUs of each node
+};
+
+// Nodes from /sys/devices/system/node with at least one usable CPU; a single node holding all
+// usable CPUs when the system reports none. maxNodes > 0 keeps only the first maxNodes nodes.
+NumaTopology discoverTopology(int maxNodes);
+
+struct WorkerPlacement {
+    int node = -1;              // index into the topology, -1 = not pinned
+    std::vector<int> cpus;
+};
+
+// Worker w goes to node w % nodes; with PIN_CORES it gets the (w / nodes)-th core of that
+// node (wrapping when there are more workers than cores), with PIN_NUMA the whole node
+WorkerPlacement placeWorker(const NumaTopology &topology, PinMode mode, int worker);
+
+// Restrict the calling thread to the placement's CPUs
+bool pinCurrentThread(const WorkerPlacement &placement, std::string &error);
+
+// "node 1, cpus 16-31" / "unpinned"; and "2 NUMA nodes (0: 0-15, 1: 16-31)"
+std::string describePlacement(const NumaTopology &topology, const WorkerPlacement &placement);
+std::string describeTopology(const NumaTopology &topology);
+
+#endif // IQFIT_AFFINITY_H
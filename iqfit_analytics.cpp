@@ -0,0 +1,338 @@
+// iqfit_analytics.cpp
+// Solution-space counters (cell coverage, piece adjacency, placement use) and their JSON and
+// CSV reports.
+
+#include "iqfit_analytics.h"
+
+#include <fstream>
+#include <algorithm>
+#include <unordered_map>
+#include <cstdio>
+#include <cstring>
+
+SolutionAnalytics::SolutionAnalytics(const PuzzleTables &puzzle) : puzzle(puzzle) {
+    const int pieces = puzzle.totalPieces, cells = puzzle.totalCells;
+    coverageOffset = 2;
+    adjacencyOffset = coverageOffset + (size_t)pieces * cells;
+    placementOffset = adjacencyOffset + (size_t)pieces * pieces;
+    size_t placementCounters = 0;
+    firstPlacementCounter.resize(pieces);
+    placementsByLowestCell.assign(pieces, std::vector<std::vector<int>>(cells));
+    for (int p = 0; p < pieces; ++p) {
+        firstPlacementCounter[p] = placementOffset + placementCounters;
+        const auto &placements = puzzle.piecePlacementCells[p];
+        placementCounters += placements.size();
+        for (size_t i = 0; i < placements.size(); ++i) {
+            int lowest = *std::min_element(placements[i].begin(), placements[i].end());
+            placementsByLowestCell[p][lowest].push_back(i);
+        }
+    }
+    values.assign(placementOffset + placementCounters, 0);
+}
+
+void SolutionAnalytics::addSolution(const char *board) {
+    const int pieces = puzzle.totalPieces, cells = puzzle.totalCells;
+    ++values[0];
+    values[1] += fnv1aHash(board, cells);
+
+    // Cell coverage, and each piece's lowest cell and size for identifying its placement
+    std::array<int, MAX_PIECES> lowestCell, pieceSize;
+    lowestCell.fill(-1);
+    pieceSize.fill(0);
+    for (int cell = 0; cell < cells; ++cell) {
+        int p = board[cell] - 'A';
+        if (p < 0 || p >= pieces) continue;
+        ++values[coverageOffset + p * cells + cell];
+        if (lowestCell[p] < 0) lowestCell[p] = cell;
+        ++pieceSize[p];
+    }
+    for (int p = 0; p < pieces; ++p) {
+        if (lowestCell[p] < 0) continue;
+        for (int placementIdx : placementsByLowestCell[p][lowestCell[p]]) {
+            const std::vector<int> &placement = puzzle.piecePlacementCells[p][placementIdx];
+            if ((int)placement.size() != pieceSize[p]) continue;
+            bool matches = true;
+            for (int cell : placement) matches = matches && board[cell] == 'A' + p;
+            if (matches) {
+                ++values[firstPlacementCounter[p] + placementIdx];
+                break;
+            }
+        }
+    }
+
+    // Pieces sharing an edge, counted once per solution and pair
+    std::array<unsigned char, MAX_PIECES * MAX_PIECES> touching;
+    std::fill(touching.begin(), touching.begin() + pieces * pieces, 0);
+    auto markPair = [&](char a, char b) {
+        int pa = a - 'A', pb = b - 'A';
+        if (pa < 0 || pa >= pieces || pb < 0 || pb >= pieces || pa == pb) return;
+        touching[pa * pieces + pb] = touching[pb * pieces + pa] = 1;
+    };
+    for (int y = 0; y < puzzle.boardHeight; ++y) {
+        for (int x = 0; x < puzzle.boardWidth; ++x) {
+            int cell = y * puzzle.boardWidth + x;
+            if (x + 1 < puzzle.boardWidth) markPair(board[cell], board[cell + 1]);
+            if (y + 1 < puzzle.boardHeight) markPair(board[cell], board[cell + puzzle.boardWidth]);
+        }
+    }
+    for (int i = 0; i < pieces * pieces; ++i) {
+        if (touching[i]) ++values[adjacencyOffset + i];
+    }
+}
+
+void SolutionAnalytics::merge(const SolutionAnalytics &other) {
+    for (size_t i = 0; i < values.size(); ++i) values[i] += other.values[i];
+}
+
+bool SolutionAnalytics::writeReports(const std::string &prefix, std::string &error) const {
+    return writeJson(prefix + ".json", error) && writeCsv(prefix, error);
+}
+
+bool SolutionAnalytics::writeJson(const std::string &path, std::string &error) const {
+    std::ofstream output(path);
+    if (!output) {
+        error = "cannot write " + path;
+        return false;
+    }
+    const int pieces = puzzle.totalPieces;
+    char digestText[17];
+    std::snprintf(digestText, sizeof(digestText), "%016llx", solutionDigest());
+    output << "{\n"
+           << "  \"boardWidth\": " << puzzle.boardWidth << ",\n"
+           << "  \"boardHeight\": " << puzzle.boardHeight << ",\n"
+           << "  \"solutions\": " << solutionCount() << ",\n"
+           << "  \"digest\": \"" << digestText << "\",\n"
+           << "  \"pieces\": [";
+    for (int p = 0; p < pieces; ++p) output << (p ? ", " : "") << "\"" << char('A' + p) << "\"";
+    output << "],\n";
+
+    // Coverage heatmaps: one grid (rows of counts) per piece
+    output << "  \"cellCounts\": {\n";
+    for (int p = 0; p < pieces; ++p) {
+        output << "    \"" << char('A' + p) << "\": [";
+        for (int y = 0; y < puzzle.boardHeight; ++y) {
+            output << (y ? ", " : "") << "[";
+            for (int x = 0; x < puzzle.boardWidth; ++x) {
+                output << (x ? ", " : "") << coverage(p, y * puzzle.boardWidth + x);
+            }
+            output << "]";
+        }
+        output << "]" << (p + 1 < pieces ? "," : "") << "\n";
+    }
+    output << "  },\n";
+
+    output << "  \"adjacency\": [";
+    for (int a = 0; a < pieces; ++a) {
+        output << (a ? ",\n    [" : "\n    [");
+        for (int b = 0; b < pieces; ++b) output << (b ? ", " : "") << adjacency(a, b);
+        output << "]";
+    }
+    output << "\n  ],\n";
+
+    // Use count of every placement, then the placements no solution uses
+    output << "  \"placementCounts\": {\n";
+    for (int p = 0; p < pieces; ++p) {
+        output << "    \"" << char('A' + p) << "\": [";
+        for (size_t i = 0; i < puzzle.piecePlacementCells[p].size(); ++i) {
+            output << (i ? ", " : "") << values[firstPlacementCounter[p] + i];
+        }
+        output << "]" << (p + 1 < pieces ? "," : "") << "\n";
+    }
+    output << "  },\n";
+    output << "  \"unusedPlacements\": {\n";
+    for (int p = 0; p < pieces; ++p) {
+        output << "    \"" << char('A' + p) << "\": [";
+        bool first = true;
+        for (size_t i = 0; i < puzzle.piecePlacementCells[p].size(); ++i) {
+            if (values[firstPlacementCounter[p] + i] != 0) continue;
+            output << (first ? "" : ", ") << i;
+            first = false;
+        }
+        output << "]" << (p + 1 < pieces ? "," : "") << "\n";
+    }
+    output << "  }\n}\n";
+    if (!output) {
+        error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
+
+bool SolutionAnalytics::writeCsv(const std::string &prefix, std::string &error) const {
+    const int pieces = puzzle.totalPieces;
+    std::string cellsPath = prefix + "_cells.csv";
+    std::ofstream cellsFile(cellsPath);
+    cellsFile << "piece,x,y,count\n";
+    for (int p = 0; p < pieces; ++p) {
+        for (int cell = 0; cell < puzzle.totalCells; ++cell) {
+            cellsFile << char('A' + p) << "," << cell % puzzle.boardWidth << "," << cell / puzzle.boardWidth
+                      << "," << coverage(p, cell) << "\n";
+        }
+    }
+    if (!cellsFile) {
+        error = "cannot write " + cellsPath;
+        return false;
+    }
+
+    std::string adjacencyPath = prefix + "_adjacency.csv";
+    std::ofstream adjacencyFile(adjacencyPath);
+    adjacencyFile << "piece";
+    for (int b = 0; b < pieces; ++b) adjacencyFile << "," << char('A' + b);
+    adjacencyFile << "\n";
+    for (int a = 0; a < pieces; ++a) {
+        adjacencyFile << char('A' + a);
+        for (int b = 0; b < pieces; ++b) adjacencyFile << "," << adjacency(a, b);
+        adjacencyFile << "\n";
+    }
+    if (!adjacencyFile) {
+        error = "cannot write " + adjacencyPath;
+        return false;
+    }
+
+    // Cells are listed space-separated so the field needs no quoting
+    std::string placementsPath = prefix + "_placements.csv";
+    std::ofstream placementsFile(placementsPath);
+    placementsFile << "piece,placement,count,cells\n";
+    for (int p = 0; p < pieces; ++p) {
+        const auto &placements = puzzle.piecePlacementCells[p];
+        for (size_t i = 0; i < placements.size(); ++i) {
+            placementsFile << char('A' + p) << "," << i << "," << values[firstPlacementCounter[p] + i] << ",";
+            for (size_t c = 0; c < placements[i].size(); ++c) placementsFile << (c ? " " : "") << placements[i][c];
+            placementsFile << "\n";
+        }
+    }
+    if (!placementsFile) {
+        error = "cannot write " + placementsPath;
+        return false;
+    }
+    return true;
+}
+
+void analyzeAssignedPlacementsForBoard(const PuzzleTables &puzzle, int rankId, int totalRanks, SolutionAnalytics &analytics) {
+    switch ((puzzle.totalCells + 63) / 64) {
+        case 1: analyzeAssignedPlacements<uint64_t>(puzzle, rankId, totalRanks, analytics); break;
+        case 2: analyzeAssignedPlacements<MultiWordMask<2>>(puzzle, rankId, totalRanks, analytics); break;
+        case 3: analyzeAssignedPlacements<MultiWordMask<3>>(puzzle, rankId, totalRanks, analytics); break;
+        default: analyzeAssignedPlacements<MultiWordMask<4>>(puzzle, rankId, totalRanks, analytics); break;
+    }
+}
+
+// Memoized subset DP. A completion of a mask never depends on how the covered cells were
+// filled, only on which pieces are still free, so the memo keys on the mask alone and keeps
+// every piece set that completes it; a caller then drops the sets that reuse its pieces.
+template <typename BoardMask, typename MaskHash>
+class SubsetTilingCounter {
+public:
+    SubsetTilingCounter(const PuzzleTables &puzzle, size_t memoLimit)
+        : puzzle(puzzle), piecePlacementMasks(buildPlacementMasks<BoardMask>(puzzle)), memoLimit(memoLimit) {}
+
+    // Piece sets (with their tiling counts) that fill the empty cells of mask; empty and
+    // meaningless once the memo limit is exceeded
+    const std::vector<SubsetCount> &completions(const BoardMask &mask) {
+        auto found = memo.find(mask);
+        if (found != memo.end()) return found->second;
+        if (memoRecords > memoLimit) return noCompletions;
+
+        std::vector<SubsetCount> result;
+        int cell = findFirstEmptyCell(mask, puzzle.totalCells);
+        if (cell >= puzzle.totalCells) {
+            // Full board: completed by the empty piece set, one way
+            result.push_back(SubsetCount{ 0, 1 });
+        } else {
+            for (int p = 0; p < puzzle.totalPieces; ++p) {
+                uint32_t pieceBit = 1u << p;
+                for (int placementIdx : puzzle.piecePlacementsByCell[p][cell]) {
+                    const BoardMask &placement = piecePlacementMasks[p][placementIdx];
+                    if (masksOverlap(placement, mask)) continue;
+                    // unordered_map keeps references valid across insertions
+                    for (const SubsetCount &rest : completions(mask | placement)) {
+                        if (!(rest.pieces & pieceBit)) result.push_back(SubsetCount{ rest.pieces | pieceBit, rest.tilings });
+                    }
+                }
+            }
+            // Combine equal piece sets
+            std::sort(result.begin(), result.end(), [](const SubsetCount &a, const SubsetCount &b) { return a.pieces < b.pieces; });
+            size_t kept = 0;
+            for (size_t i = 0; i < result.size(); ++i) {
+                if (kept > 0 && result[kept - 1].pieces == result[i].pieces) {
+                    result[kept - 1].tilings += result[i].tilings;
+                } else {
+                    result[kept++] = result[i];
+                }
+            }
+            result.resize(kept);
+            result.shrink_to_fit();
+        }
+        memoRecords += 1 + result.size();
+        return memo.emplace(mask, std::move(result)).first->second;
+    }
+
+    size_t recordCount() const { return memoRecords; }
+    bool limitExceeded() const { return memoRecords > memoLimit; }
+
+private:
+    struct MaskEqual {
+        bool operator()(const BoardMask &a, const BoardMask &b) const { return std::memcmp(&a, &b, sizeof(BoardMask)) == 0; }
+    };
+
+    const PuzzleTables &puzzle;
+    std::vector<std::vector<BoardMask>> piecePlacementMasks;
+    std::unordered_map<BoardMask, std::vector<SubsetCount>, MaskHash, MaskEqual> memo;
+    const std::vector<SubsetCount> noCompletions;
+    size_t memoLimit, memoRecords = 0;
+};
+
+struct WordHash {
+    size_t operator()(uint64_t mask) const { return std::hash<uint64_t>()(mask); }
+};
+
+template <int Words>
+struct MultiWordHash {
+    size_t operator()(const MultiWordMask<Words> &mask) const {
+        return fnv1aHash(reinterpret_cast<const char *>(mask.words.data()), sizeof(mask.words));
+    }
+};
+
+template <typename BoardMask, typename MaskHash>
+static bool countTilingsBySubset(const PuzzleTables &puzzle, size_t memoLimit, std::vector<SubsetCount> &counts,
+                                 size_t &memoRecords, std::string &error) {
+    SubsetTilingCounter<BoardMask, MaskHash> counter(puzzle, memoLimit);
+    counts = counter.completions(emptyBoardStart<BoardMask>(puzzle).mask);
+    memoRecords = counter.recordCount();
+    if (counter.limitExceeded()) {
+        counts.clear();
+        error = "the subset memo outgrew its limit of " + std::to_string(memoLimit) + " records; use a smaller region or raise the limit";
+        return false;
+    }
+    return true;
+}
+
+bool countTilingsBySubset(const PuzzleTables &puzzle, size_t memoLimit, std::vector<SubsetCount> &counts,
+                          size_t &memoRecords, std::string &error) {
+    switch ((puzzle.totalCells + 63) / 64) {
+        case 1: return countTilingsBySubset<uint64_t, WordHash>(puzzle, memoLimit, counts, memoRecords, error);
+        case 2: return countTilingsBySubset<MultiWordMask<2>, MultiWordHash<2>>(puzzle, memoLimit, counts, memoRecords, error);
+        case 3: return countTilingsBySubset<MultiWordMask<3>, MultiWordHash<3>>(puzzle, memoLimit, counts, memoRecords, error);
+        default: return countTilingsBySubset<MultiWordMask<4>, MultiWordHash<4>>(puzzle, memoLimit, counts, memoRecords, error);
+    }
+}
+
+bool writeSubsetCounts(const std::string &path, const PuzzleTables &puzzle, const std::vector<SubsetCount> &counts, std::string &error) {
+    std::ofstream output(path);
+    output << "pieces,piece_count,tilings\n";
+    for (const SubsetCount &subset : counts) {
+        int pieceCount = 0;
+        for (int p = 0; p < puzzle.totalPieces; ++p) {
+            if (subset.pieces & (1u << p)) {
+                output << char('A' + p);
+                ++pieceCount;
+            }
+        }
+        output << "," << pieceCount << "," << subset.tilings << "\n";
+    }
+    if (!output) {
+        error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
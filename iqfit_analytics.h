@@ -0,0 +1,89 @@
+// iqfit_analytics.h
+// Statistics over the full solution set, gathered while the search runs instead of from
+// solutions.txt: how often each piece covers each cell, how often each pair of pieces
+// touches, and how often each placement is used (placements that never appear included).
+// No board is stored. Each rank or thread fills its own counters; they are summed at the end.
+
+#ifndef IQFIT_ANALYTICS_H
+#define IQFIT_ANALYTICS_H
+
+#include "iqfit_core.h"
+#include <climits>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class SolutionAnalytics {
+public:
+    explicit SolutionAnalytics(const PuzzleTables &puzzle);
+
+    // Count one solution (row-major board, totalCells characters)
+    void addSolution(const char *board);
+
+    // Add another rank's or thread's counters (same puzzle)
+    void merge(const SolutionAnalytics &other);
+
+    // Every counter in one flat array, so ranks can sum them with a single MPI_Reduce:
+    // [solutions, digest, piece x cell coverage, piece x piece adjacency, placement uses]
+    std::vector<unsigned long long> &counters() { return values; }
+
+    unsigned long long solutionCount() const { return values[0]; }
+    unsigned long long solutionDigest() const { return values[1]; }
+
+    // <prefix>.json with everything, plus <prefix>_cells.csv, <prefix>_adjacency.csv and
+    // <prefix>_placements.csv
+    bool writeReports(const std::string &prefix, std::string &error) const;
+
+private:
+    unsigned long long coverage(int pieceIdx, int cell) const { return values[coverageOffset + pieceIdx * puzzle.totalCells + cell]; }
+    unsigned long long adjacency(int a, int b) const { return values[adjacencyOffset + a * puzzle.totalPieces + b]; }
+
+    bool writeJson(const std::string &path, std::string &error) const;
+    bool writeCsv(const std::string &prefix, std::string &error) const;
+
+    const PuzzleTables &puzzle;
+    std::vector<unsigned long long> values;
+    size_t coverageOffset, adjacencyOffset, placementOffset;
+    std::vector<size_t> firstPlacementCounter;      // per piece, into the placement uses
+    // Placements of each piece whose lowest cell is the given cell (to identify a placement
+    // from a solved board)
+    std::vector<std::vector<std::vector<int>>> placementsByLowestCell;
+};
+
+// Run this rank's share of first-piece placements (round-robin, like the plain search) and
+// count every solution into analytics
+template <typename BoardMask>
+void analyzeAssignedPlacements(const PuzzleTables &puzzle, int rankId, int totalRanks, SolutionAnalytics &analytics) {
+    auto piecePlacementMasks = buildPlacementMasks<BoardMask>(puzzle);
+    SearchStart<BoardMask> start = emptyBoardStart<BoardMask>(puzzle);
+    auto countSolution = [&](const char *board) {
+        analytics.addSolution(board);
+        return true;
+    };
+    int totalStartingPlacements = piecePlacementMasks[0].size();
+    for (int i = rankId; i < totalStartingPlacements; i += totalRanks) {
+        SearchState state;
+        state.unit = i;
+        resumeSearch(puzzle, piecePlacementMasks, start, state, LLONG_MAX, countSolution);
+    }
+}
+
+void analyzeAssignedPlacementsForBoard(const PuzzleTables &puzzle, int rankId, int totalRanks, SolutionAnalytics &analytics);
+
+// Tiling counts of the puzzle's open cells for every subset of its pieces, in one pass: a
+// memoized DP over (covered cells, piece set) whose value for a covered-cell mask is the
+// number of ways each piece set completes it. Only subsets that tile the region at all are
+// returned, as (piece bit set, tilings) pairs ordered by bit set. The memo grows with the
+// region; once it holds more than memoLimit records (masks plus piece sets) the count stops
+// and returns false. memoRecords receives the final memo size.
+struct SubsetCount {
+    uint32_t pieces;
+    unsigned long long tilings;
+};
+bool countTilingsBySubset(const PuzzleTables &puzzle, size_t memoLimit, std::vector<SubsetCount> &counts,
+                          size_t &memoRecords, std::string &error);
+
+// CSV with one row per tiling subset: piece letters, piece count, tilings
+bool writeSubsetCounts(const std::string &path, const PuzzleTables &puzzle, const std::vector<SubsetCount> &counts, std::string &error);
+
+#endif // IQFIT_ANALYTICS_H
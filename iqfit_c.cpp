@@ -0,0 +1,250 @@
+// iqfit_c.cpp
+// C wrapper around the C++ library API. No C++ exception may cross into C callers, so
+// every entry point that allocates reports failures through its return value instead.
+
+#include "iqfit_c.h"
+#include "iqfit_solver.h"
+
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <new>
+
+struct iqfit_puzzle {
+    PreparedPuzzle prepared;
+};
+
+struct iqfit_control {
+    SolveControl control;
+};
+
+struct iqfit_stream {
+    SolutionStream stream;
+    std::string board;
+    size_t cells = 0;
+};
+
+static void copyError(const std::string &message, char *error, size_t errorSize) {
+    if (!error || errorSize == 0) return;
+    size_t length = std::min(message.size(), errorSize - 1);
+    std::memcpy(error, message.data(), length);
+    error[length] = '\0';
+}
+
+// Run body, turning any exception it throws into failValue and an error message
+template <class F, class R>
+static R guarded(F body, R failValue, char *error, size_t errorSize) {
+    try {
+        return body();
+    } catch (const std::bad_alloc &) {
+        copyError("out of memory", error, errorSize);
+    } catch (const std::exception &e) {
+        copyError(e.what(), error, errorSize);
+    } catch (...) {
+        copyError("unexpected error", error, errorSize);
+    }
+    return failValue;
+}
+
+// A loaded puzzle, or null with the error copied out; the handle is freed on every failure
+template <class Load>
+static iqfit_puzzle *loadPuzzle(Load load, char *error, size_t errorSize) {
+    return guarded([&]() -> iqfit_puzzle * {
+        std::unique_ptr<iqfit_puzzle> puzzle(new iqfit_puzzle());
+        std::string message;
+        if (!load(puzzle->prepared, message)) {
+            copyError(message, error, errorSize);
+            return nullptr;
+        }
+        return puzzle.release();
+    }, (iqfit_puzzle *)nullptr, error, errorSize);
+}
+
+extern "C" {
+
+iqfit_puzzle *iqfit_puzzle_from_text(const char *definition, char *error, size_t error_size) {
+    return loadPuzzle([&](PreparedPuzzle &prepared, std::string &message) {
+        return preparePuzzle(definition ? definition : "", prepared, message);
+    }, error, error_size);
+}
+
+iqfit_puzzle *iqfit_puzzle_from_file(const char *path, char *error, size_t error_size) {
+    if (!path) {
+        copyError("no puzzle path given", error, error_size);
+        return nullptr;
+    }
+    return loadPuzzle([&](PreparedPuzzle &prepared, std::string &message) {
+        return preparePuzzleFile(path, prepared, message);
+    }, error, error_size);
+}
+
+void iqfit_puzzle_free(iqfit_puzzle *puzzle) {
+    delete puzzle;
+}
+
+int iqfit_puzzle_width(const iqfit_puzzle *puzzle) {
+    return puzzle ? puzzle->prepared.tables.boardWidth : 0;
+}
+
+int iqfit_puzzle_height(const iqfit_puzzle *puzzle) {
+    return puzzle ? puzzle->prepared.tables.boardHeight : 0;
+}
+
+int iqfit_puzzle_pieces(const iqfit_puzzle *puzzle) {
+    return puzzle ? puzzle->prepared.tables.totalPieces : 0;
+}
+
+void iqfit_puzzle_set_propagation(iqfit_puzzle *puzzle, int enabled) {
+    if (puzzle) puzzle->prepared.searchOptions.propagate = enabled != 0;
+}
+
+void iqfit_puzzle_set_ordering(iqfit_puzzle *puzzle, int ordering) {
+    if (!puzzle || ordering < IQFIT_ORDER_INDEX || ordering > IQFIT_ORDER_FEWEST_PLACEMENTS) return;
+    SearchOptions &options = puzzle->prepared.searchOptions;
+    options.candidateOrder.clear();
+    applyPieceOrdering(puzzle->prepared.tables, (PieceOrdering)ordering, options);
+}
+
+int iqfit_puzzle_learn_ordering(iqfit_puzzle *puzzle, const char *const *training_boards, size_t board_count,
+                                long long nodes_per_board, char *error, size_t error_size) {
+    if (!puzzle || (!training_boards && board_count > 0)) {
+        copyError("no puzzle or training boards given", error, error_size);
+        return -1;
+    }
+    return guarded([&]() -> int {
+        std::vector<std::string> boards;
+        for (size_t b = 0; b < board_count; ++b) boards.push_back(training_boards[b] ? training_boards[b] : "");
+        std::string message;
+        if (!learnSearchOrdering(puzzle->prepared, boards, nodes_per_board, puzzle->prepared.searchOptions, message)) {
+            copyError(message, error, error_size);
+            return -1;
+        }
+        return 0;
+    }, -1, error, error_size);
+}
+
+iqfit_control *iqfit_control_new(void) {
+    return new (std::nothrow) iqfit_control();
+}
+
+void iqfit_control_cancel(iqfit_control *control) {
+    if (control) control->control.cancel();
+}
+
+void iqfit_control_reset(iqfit_control *control) {
+    if (control) control->control.cancelRequested = false;
+}
+
+void iqfit_control_free(iqfit_control *control) {
+    delete control;
+}
+
+int iqfit_solve(const iqfit_puzzle *puzzle, const char *partial_board,
+                iqfit_solution_fn callback, void *user_data, iqfit_control *control,
+                iqfit_result *result, char *error, size_t error_size) {
+    if (!puzzle) {
+        copyError("no puzzle given", error, error_size);
+        return -1;
+    }
+    return guarded([&]() -> int {
+        size_t cells = puzzle->prepared.tables.totalCells;
+        SolutionCallback onSolution;
+        if (callback) {
+            onSolution = [callback, user_data, cells](const char *board) {
+                return callback(board, cells, user_data) != 0;
+            };
+        }
+        SolveResult solved;
+        std::string message;
+        if (!solvePartialBoard(puzzle->prepared, partial_board ? partial_board : "", onSolution,
+                               control ? &control->control : nullptr, solved, message)) {
+            copyError(message, error, error_size);
+            return -1;
+        }
+        if (result) {
+            result->solutions = solved.solutionCount;
+            result->digest = solved.solutionDigest;
+            result->stopped = solved.stopped ? 1 : 0;
+        }
+        return 0;
+    }, -1, error, error_size);
+}
+
+int iqfit_count(const iqfit_puzzle *puzzle, const char *partial_board, iqfit_control *control,
+                iqfit_result *result, char *error, size_t error_size) {
+    return iqfit_solve(puzzle, partial_board, nullptr, nullptr, control, result, error, error_size);
+}
+
+int iqfit_hint(const iqfit_puzzle *puzzle, const char *partial_board, iqfit_control *control,
+               int *live_counts, size_t live_count_size, char *forced_board, size_t board_size,
+               iqfit_hint_result *result, char *error, size_t error_size) {
+    if (!puzzle) {
+        copyError("no puzzle given", error, error_size);
+        return -1;
+    }
+    size_t pieces = puzzle->prepared.tables.totalPieces;
+    if ((live_counts && live_count_size < pieces) || (forced_board && board_size <= (size_t)puzzle->prepared.tables.totalCells)) {
+        copyError("output buffer too small", error, error_size);
+        return -1;
+    }
+    return guarded([&]() -> int {
+        HintResult hint;
+        std::string message;
+        if (!hintPartialBoard(puzzle->prepared, partial_board ? partial_board : "",
+                              control ? &control->control : nullptr, hint, message)) {
+            copyError(message, error, error_size);
+            return -1;
+        }
+        if (live_counts) {
+            for (size_t piece = 0; piece < pieces; ++piece) live_counts[piece] = (int)hint.livePlacements[piece].size();
+        }
+        if (forced_board) {
+            std::memcpy(forced_board, hint.forcedBoard.data(), hint.forcedBoard.size());
+            forced_board[hint.forcedBoard.size()] = '\0';
+        }
+        if (result) {
+            result->solvable = hint.solvable ? 1 : 0;
+            result->stopped = hint.stopped ? 1 : 0;
+            result->forced = (int)hint.forcedPlacements.size();
+        }
+        return 0;
+    }, -1, error, error_size);
+}
+
+iqfit_stream *iqfit_stream_new(const iqfit_puzzle *puzzle, const char *partial_board,
+                               char *error, size_t error_size) {
+    if (!puzzle) {
+        copyError("no puzzle given", error, error_size);
+        return nullptr;
+    }
+    return guarded([&]() -> iqfit_stream * {
+        std::unique_ptr<iqfit_stream> stream(new iqfit_stream());
+        std::string message;
+        if (!stream->stream.open(puzzle->prepared, partial_board ? partial_board : "", message)) {
+            copyError(message, error, error_size);
+            return nullptr;
+        }
+        stream->cells = puzzle->prepared.tables.totalCells;
+        return stream.release();
+    }, (iqfit_stream *)nullptr, error, error_size);
+}
+
+int iqfit_stream_next(iqfit_stream *stream, char *board, size_t board_size, iqfit_control *control) {
+    // Check the buffer first so a solution is never consumed without being returned
+    if (!stream || !board || board_size <= stream->cells) return -1;
+    // No error buffer here: a failure only returns -1
+    return guarded([&]() -> int {
+        if (!stream->stream.next(stream->board, control ? &control->control : nullptr)) {
+            return stream->stream.done() ? 0 : -1;
+        }
+        std::memcpy(board, stream->board.data(), stream->board.size());
+        board[stream->board.size()] = '\0';
+        return 1;
+    }, -1, nullptr, 0);
+}
+
+void iqfit_stream_free(iqfit_stream *stream) {
+    delete stream;
+}
+
+}
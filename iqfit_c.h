@@ -0,0 +1,101 @@
+/* iqfit_c.h
+ * C interface of the solver library (libiqfit) for other languages and runtimes.
+ * Only opaque handles, plain integers and char buffers cross this boundary.
+ *
+ * A puzzle handle is immutable once loaded and may be used by any number of threads at
+ * the same time. A control handle cancels the solves it is passed to. Functions that can
+ * fail return 0 on success and -1 on failure, with a message written to error (if given).
+ */
+
+#ifndef IQFIT_C_H
+#define IQFIT_C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct iqfit_puzzle iqfit_puzzle;
+typedef struct iqfit_control iqfit_control;
+typedef struct iqfit_stream iqfit_stream;
+
+typedef struct iqfit_result {
+    uint64_t solutions;
+    uint64_t digest;
+    int stopped;    /* 1 if cancelled or stopped by the callback before the search ended */
+} iqfit_result;
+
+/* Receives each solution (cells characters, row-major); return 0 to stop the solve */
+typedef int (*iqfit_solution_fn)(const char *board, size_t cells, void *user_data);
+
+/* Load a puzzle from definition text (NULL or "" = standard 11x5 set) or from a file;
+ * NULL on failure */
+iqfit_puzzle *iqfit_puzzle_from_text(const char *definition, char *error, size_t error_size);
+iqfit_puzzle *iqfit_puzzle_from_file(const char *path, char *error, size_t error_size);
+void iqfit_puzzle_free(iqfit_puzzle *puzzle);
+
+int iqfit_puzzle_width(const iqfit_puzzle *puzzle);
+int iqfit_puzzle_height(const iqfit_puzzle *puzzle);
+int iqfit_puzzle_pieces(const iqfit_puzzle *puzzle);
+
+/* Enable constraint propagation (forced moves, dead cells) for the puzzle's solves, hints
+ * and streams; faster on boards that already hold several pieces. Call before the puzzle
+ * is shared between threads or has open streams. */
+void iqfit_puzzle_set_propagation(iqfit_puzzle *puzzle, int enabled);
+
+/* Order in which the search tries pieces (same rule as propagation: set before sharing).
+ * The learned order is computed from training boards, each searched for at most
+ * nodes_per_board nodes; it also orders each piece's placements at every cell. */
+enum { IQFIT_ORDER_INDEX = 0, IQFIT_ORDER_LARGEST_FIRST = 1, IQFIT_ORDER_FEWEST_PLACEMENTS = 2 };
+void iqfit_puzzle_set_ordering(iqfit_puzzle *puzzle, int ordering);
+int iqfit_puzzle_learn_ordering(iqfit_puzzle *puzzle, const char *const *training_boards, size_t board_count,
+                                long long nodes_per_board, char *error, size_t error_size);
+
+iqfit_control *iqfit_control_new(void);
+void iqfit_control_cancel(iqfit_control *control);    /* safe to call from any thread */
+void iqfit_control_reset(iqfit_control *control);
+void iqfit_control_free(iqfit_control *control);
+
+/* Solve a partial board (same text format as the C++ API; NULL = empty board).
+ * callback and control may be NULL. */
+int iqfit_solve(const iqfit_puzzle *puzzle, const char *partial_board,
+                iqfit_solution_fn callback, void *user_data, iqfit_control *control,
+                iqfit_result *result, char *error, size_t error_size);
+
+/* Count the completions of a partial board */
+int iqfit_count(const iqfit_puzzle *puzzle, const char *partial_board, iqfit_control *control,
+                iqfit_result *result, char *error, size_t error_size);
+
+typedef struct iqfit_hint_result {
+    int solvable;
+    int stopped;    /* 1 if cancelled before the hint was complete */
+    int forced;     /* number of forced placements */
+} iqfit_hint_result;
+
+/* Hint for a partial board. live_counts (one entry per piece, may be NULL) receives how
+ * many placements of each piece appear in at least one completion (0 for pieces already
+ * placed); forced_board (at least cells + 1 bytes, may be NULL) receives the partial board
+ * with every forced placement filled in. */
+int iqfit_hint(const iqfit_puzzle *puzzle, const char *partial_board, iqfit_control *control,
+               int *live_counts, size_t live_count_size, char *forced_board, size_t board_size,
+               iqfit_hint_result *result, char *error, size_t error_size);
+
+/* Lazy iteration: each iqfit_stream_next resumes the search and returns the next solution.
+ * The puzzle must outlive the stream. NULL on failure. */
+iqfit_stream *iqfit_stream_new(const iqfit_puzzle *puzzle, const char *partial_board,
+                               char *error, size_t error_size);
+
+/* Copy the next solution into board (at least cells + 1 bytes, NUL-terminated).
+ * Returns 1 for a solution, 0 when there are no more, -1 if cancelled, board is too small or
+ * the search failed (the stream can continue after a cancel once the control is reset; after
+ * a failure it keeps returning -1, never 0, so a cut-short enumeration is not taken as complete). */
+int iqfit_stream_next(iqfit_stream *stream, char *board, size_t board_size, iqfit_control *control);
+void iqfit_stream_free(iqfit_stream *stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IQFIT_C_H */
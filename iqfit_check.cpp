@@ -0,0 +1,58 @@
+// iqfit_check.cpp
+// Validates a solutions file (solutions.txt, solutions_100.txt, ...) against the puzzle: every
+// board must be a complete tiling with each piece on one of its placements. Prints the board
+// count, invalid and duplicate boards, and the totals and digest of the distinct valid
+// boards, which match the solver's own output when the file is complete. Exits with status 2
+// when any board is invalid or repeated.
+
+#include "iqfit_core.h"
+#include "iqfit_validate.h"
+#include <iostream>
+#include <string>
+#include <thread>
+#include <cstdlib>
+
+int main(int argc, char **argv) {
+    std::string puzzlePath, inputPath;
+    int threads = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--puzzle" && i + 1 < argc) {
+            puzzlePath = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::atoi(argv[++i]);
+        } else if (!arg.empty() && arg[0] != '-' && inputPath.empty()) {
+            inputPath = arg;
+        } else {
+            inputPath.clear();
+            break;
+        }
+    }
+    if (inputPath.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [--puzzle <file>] [--threads <count>] <solutions file>\n";
+        return 1;
+    }
+    if (threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    PuzzleTables puzzle;
+    std::string error;
+    if (!puzzlePath.empty() && !loadPuzzleDefinition(puzzlePath, puzzle, error)) {
+        std::cerr << "Error: " << error << "\n";
+        return 1;
+    }
+    double startTime = wallClockSeconds();
+    precomputeAllPiecePlacements(puzzle);
+
+    ValidationReport report;
+    if (!validateSolutionsFile(puzzle, inputPath, threads, report, error)) {
+        std::cerr << "Error: " << error << "\n";
+        return 1;
+    }
+    for (const std::string &problem : report.problems) std::cout << inputPath << ": " << problem << "\n";
+    std::cout << "Boards: " << report.boards << "\n";
+    std::cout << "Invalid boards: " << report.invalidBoards << "\n";
+    std::cout << "Duplicate boards: " << report.duplicateBoards << "\n";
+    printSolutionTotals(report.distinctBoards(), report.validDigest);
+    std::cout << "Elapsed time: " << (wallClockSeconds() - startTime) << " seconds\n";
+    return report.invalidBoards == 0 && report.duplicateBoards == 0 ? 0 : 2;
+}
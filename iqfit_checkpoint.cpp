@@ -0,0 +1,143 @@
+// iqfit_checkpoint.cpp
+// Checkpoint files for long enumerations: rank<N>.ckpt holds the finished units, the position
+// inside the current unit and the rank's totals; rank<N>.solutions optionally holds its boards.
+
+#include "iqfit_checkpoint.h"
+
+#include <fstream>
+#include <cstdio>
+#include <cerrno>
+#include <csignal>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::string checkpointPath(const CheckpointOptions &options, int rankId, const char *suffix) {
+    return options.directory + "/rank" + std::to_string(rankId) + suffix;
+}
+
+bool writeCheckpoint(const PuzzleTables &puzzle, const CheckpointOptions &options, int rankId, int totalRanks, const RankProgress &progress) {
+    std::string finalPath = checkpointPath(options, rankId, ".ckpt");
+    std::string tempPath = finalPath + ".tmp";
+    FILE *file = std::fopen(tempPath.c_str(), "w");
+    if (!file) return false;
+    std::fprintf(file, "iqfit-checkpoint 2\n");
+    std::fprintf(file, "puzzle %016llx\n", (unsigned long long)puzzleFingerprint(puzzle));
+    std::fprintf(file, "ranks %d\n", totalRanks);
+    std::fprintf(file, "solutions %llu\n", (unsigned long long)progress.solutionCount);
+    std::fprintf(file, "digest %016llx\n", (unsigned long long)progress.solutionDigest);
+    std::fprintf(file, "flushed %llu\n", (unsigned long long)progress.flushedSolutions);
+    std::fprintf(file, "units %zu", progress.completedUnits.size());
+    for (int unit : progress.completedUnits) std::fprintf(file, " %d", unit);
+    std::fprintf(file, "\ncurrent %s\n", serializeSearchState(progress.currentUnit).c_str());
+    bool written = std::fflush(file) == 0 && fsync(fileno(file)) == 0;
+    written = (std::fclose(file) == 0) && written;
+    return written && std::rename(tempPath.c_str(), finalPath.c_str()) == 0;
+}
+
+bool readCheckpoint(const PuzzleTables &puzzle, const CheckpointOptions &options, int rankId, int totalRanks, RankProgress &progress, std::string &error) {
+    std::ifstream inputFile(checkpointPath(options, rankId, ".ckpt"));
+    if (!inputFile.is_open()) {
+        error = "no checkpoint for rank " + std::to_string(rankId);
+        return false;
+    }
+    std::string magic, key;
+    int version = 0, savedRanks = 0;
+    unsigned long long fingerprint = 0, count = 0, digest = 0, flushed = 0;
+    size_t unitCount = 0;
+    inputFile >> magic >> version;
+    inputFile >> key >> std::hex >> fingerprint >> std::dec;
+    inputFile >> key >> savedRanks;
+    inputFile >> key >> count;
+    inputFile >> key >> std::hex >> digest >> std::dec;
+    inputFile >> key >> flushed;
+    inputFile >> key >> unitCount;
+    RankProgress restored;
+    for (size_t u = 0; u < unitCount; ++u) {
+        int unit;
+        if (!(inputFile >> unit)) break;
+        restored.completedUnits.push_back(unit);
+    }
+    std::string currentUnit;
+    inputFile >> key;
+    std::getline(inputFile, currentUnit);
+    if (!inputFile || magic != "iqfit-checkpoint" || version != 2 || !parseSearchState(currentUnit, restored.currentUnit)) {
+        error = "malformed checkpoint for rank " + std::to_string(rankId);
+        return false;
+    }
+    if (fingerprint != puzzleFingerprint(puzzle) || savedRanks != totalRanks) {
+        error = "checkpoint was written for a different puzzle or rank count";
+        return false;
+    }
+    restored.solutionCount = count;
+    restored.solutionDigest = digest;
+    restored.flushedSolutions = flushed;
+    progress = restored;
+    return true;
+}
+
+bool flushSolutions(const PuzzleTables &puzzle, const CheckpointOptions &options, int rankId, const std::vector<char> &localSolutions, RankProgress &progress) {
+    size_t flushedBytes = progress.flushedSolutions * puzzle.totalCells;
+    if (flushedBytes == localSolutions.size()) return true;
+    FILE *file = std::fopen(checkpointPath(options, rankId, ".solutions").c_str(), "ab");
+    if (!file) return false;
+    bool written = std::fwrite(localSolutions.data() + flushedBytes, 1, localSolutions.size() - flushedBytes, file)
+                   == localSolutions.size() - flushedBytes;
+    written = written && std::fflush(file) == 0 && fsync(fileno(file)) == 0;
+    written = (std::fclose(file) == 0) && written;
+    if (written) progress.flushedSolutions = localSolutions.size() / puzzle.totalCells;
+    return written;
+}
+
+bool restoreFlushedSolutions(const PuzzleTables &puzzle, const CheckpointOptions &options, int rankId, const RankProgress &progress, std::vector<char> &localSolutions) {
+    std::string path = checkpointPath(options, rankId, ".solutions");
+    size_t flushedBytes = progress.flushedSolutions * puzzle.totalCells;
+    localSolutions.resize(flushedBytes);
+    if (flushedBytes == 0) return std::remove(path.c_str()) == 0 || errno == ENOENT;
+    std::ifstream inputFile(path, std::ios::binary);
+    if (!inputFile.read(localSolutions.data(), flushedBytes)) return false;
+    inputFile.close();
+    return truncate(path.c_str(), flushedBytes) == 0;
+}
+
+static void handlePreemptSignal(int) {
+    preemptRequested = 1;
+}
+
+void installPreemptHandlers() {
+    // SIGUSR1 (forwarded by mpirun) or SIGTERM: save the exact search position and stop
+    std::signal(SIGUSR1, handlePreemptSignal);
+    std::signal(SIGTERM, handlePreemptSignal);
+}
+
+void prepareRankCheckpoint(const PuzzleTables &puzzle, const CheckpointOptions &options, int rankId, int totalRanks,
+                           RankProgress &progress, std::vector<char> &localSolutions) {
+    mkdir(options.directory.c_str(), 0755);
+    std::string error;
+    if (options.restart && readCheckpoint(puzzle, options, rankId, totalRanks, progress, error)) {
+        if (options.flushSolutions && progress.flushedSolutions != progress.solutionCount) {
+            std::cerr << "Warning: rank " << rankId << " checkpoint has no flushed solutions;"
+                      << " earlier boards will be missing from solutions.txt\n";
+        }
+        if (!restoreFlushedSolutions(puzzle, options, rankId, progress, localSolutions)) {
+            std::cerr << "Warning: rank " << rankId << " could not reload its flushed solutions\n";
+            localSolutions.clear();
+            progress.flushedSolutions = 0;
+        }
+        std::cout << "Rank " << rankId << " resumed with " << progress.completedUnits.size()
+                  << " finished units and " << progress.solutionCount << " solutions\n";
+    } else {
+        if (options.restart) std::cerr << "Warning: " << error << "; starting rank " << rankId << " from scratch\n";
+        if (options.flushSolutions) std::remove(checkpointPath(options, rankId, ".solutions").c_str());
+    }
+}
+
+SearchStatus searchAssignedPlacementsForBoard(const PuzzleTables &puzzle, int rankId, int totalRanks, const CheckpointOptions &checkpoints,
+                                              RankProgress &progress, std::vector<char> &localSolutions,
+                                              const std::function<void()> &afterSlice) {
+    switch ((puzzle.totalCells + 63) / 64) {
+        case 1: return searchAssignedPlacements<uint64_t>(puzzle, rankId, totalRanks, checkpoints, progress, localSolutions, afterSlice);
+        case 2: return searchAssignedPlacements<MultiWordMask<2>>(puzzle, rankId, totalRanks, checkpoints, progress, localSolutions, afterSlice);
+        case 3: return searchAssignedPlacements<MultiWordMask<3>>(puzzle, rankId, totalRanks, checkpoints, progress, localSolutions, afterSlice);
+        default: return searchAssignedPlacements<MultiWordMask<4>>(puzzle, rankId, totalRanks, checkpoints, progress, localSolutions, afterSlice);
+    }
+}
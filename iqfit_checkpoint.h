@@ -0,0 +1,130 @@
+// iqfit_checkpoint.h
+// Per-rank checkpoints and the static round-robin search over first-piece placements.
+// A "rank" is an MPI rank in iqfit_mpi and a thread in iqfit_threads; both write the same
+// checkpoint files, so a run can be resumed by either solver with the same rank count.
+
+#ifndef IQFIT_CHECKPOINT_H
+#define IQFIT_CHECKPOINT_H
+
+#include "iqfit_core.h"
+
+#include <iostream>
+#include <set>
+#include <functional>
+
+// Checkpoint settings taken from the command line
+struct CheckpointOptions {
+    std::string directory;          // empty = checkpoints disabled
+    double intervalSeconds = 60.0;
+    bool flushSolutions = false;    // also append this rank's boards to <dir>/rank<N>.solutions
+    bool restart = false;
+};
+
+// Per-rank progress that survives a restart
+struct RankProgress {
+    std::vector<int> completedUnits;    // first-piece placements fully searched
+    uint64_t solutionCount = 0;         // includes boards found before a restart
+    uint64_t solutionDigest = 0;
+    uint64_t flushedSolutions = 0;      // boards already durable in the rank's solutions file
+    SearchState currentUnit;            // position inside a partly searched unit (unit -1 = none)
+};
+
+std::string checkpointPath(const CheckpointOptions &options, int rankId, const char *suffix);
+
+// Write the progress file atomically: fill a temporary file, fsync it, then rename over the old one
+bool writeCheckpoint(const PuzzleTables &puzzle, const CheckpointOptions &options, int rankId, int totalRanks, const RankProgress &progress);
+
+// Read a checkpoint written by the same puzzle and rank count; false if none is usable
+bool readCheckpoint(const PuzzleTables &puzzle, const CheckpointOptions &options, int rankId, int totalRanks, RankProgress &progress, std::string &error);
+
+// Append boards found since the last checkpoint to the rank's solutions file and fsync it
+bool flushSolutions(const PuzzleTables &puzzle, const CheckpointOptions &options, int rankId, const std::vector<char> &localSolutions, RankProgress &progress);
+
+// Reload the boards recorded by a checkpoint, dropping any tail appended after it was written
+bool restoreFlushedSolutions(const PuzzleTables &puzzle, const CheckpointOptions &options, int rankId, const RankProgress &progress, std::vector<char> &localSolutions);
+
+// Route SIGUSR1 and SIGTERM to preemptRequested so the search saves its position and stops
+void installPreemptHandlers();
+
+// Create the checkpoint directory and, with --restart, load this rank's saved progress and
+// flushed boards; otherwise start from scratch and discard a stale solutions file
+void prepareRankCheckpoint(const PuzzleTables &puzzle, const CheckpointOptions &options, int rankId, int totalRanks,
+                           RankProgress &progress, std::vector<char> &localSolutions);
+
+// Explore this rank's share of first-piece placements (round-robin distribution).
+// Each first-piece placement is one work unit, searched in slices of nodes. With checkpoints
+// enabled, finished units, the exact position inside the current unit and the rank's totals
+// are saved periodically, so a restarted or preempted run continues where it stopped.
+// Returns SEARCH_PAUSED if the search was preempted before all assigned units were finished,
+// and SEARCH_INVALID_STATE if a restored position does not fit the puzzle.
+// afterSlice, if set, runs after every slice once its boards are counted; it may take boards
+// out of localSolutions (only without checkpoints, which flush from that buffer).
+template <typename BoardMask>
+SearchStatus searchAssignedPlacements(const PuzzleTables &puzzle, int rankId, int totalRanks, const CheckpointOptions &checkpoints,
+                                      RankProgress &progress, std::vector<char> &localSolutions,
+                                      const std::function<void()> &afterSlice = std::function<void()>()) {
+    const long long nodesPerSlice = 1LL << 20;
+    auto piecePlacementMasks = buildPlacementMasks<BoardMask>(puzzle);
+    SearchStart<BoardMask> start = emptyBoardStart<BoardMask>(puzzle);
+
+    std::set<int> finishedUnits(progress.completedUnits.begin(), progress.completedUnits.end());
+    bool checkpointsEnabled = !checkpoints.directory.empty();
+    double lastCheckpoint = wallClockSeconds();
+
+    auto saveCheckpoint = [&]() {
+        bool saved = (!checkpoints.flushSolutions || flushSolutions(puzzle, checkpoints, rankId, localSolutions, progress))
+                     && writeCheckpoint(puzzle, checkpoints, rankId, totalRanks, progress);
+        if (!saved) std::cerr << "Warning: rank " << rankId << " could not write its checkpoint\n";
+        lastCheckpoint = wallClockSeconds();
+    };
+
+    int totalStartingPlacements = piecePlacementMasks[0].size();
+    for (int i = rankId; i < totalStartingPlacements; i += totalRanks) {
+        if (finishedUnits.count(i)) continue;
+        SearchState &state = progress.currentUnit;
+        if (state.unit != i) {
+            state.unit = i;
+            state.frames.clear();
+        }
+
+        SearchStatus status;
+        do {
+            size_t boardsBefore = localSolutions.size() / puzzle.totalCells;
+            status = resumeSearch(puzzle, piecePlacementMasks, start, state, nodesPerSlice,
+                                  AppendSolutions{localSolutions, puzzle.totalCells});
+            if (status == SEARCH_INVALID_STATE) {
+                std::cerr << "Error: rank " << rankId << " checkpoint holds an invalid search position\n";
+                return SEARCH_INVALID_STATE;
+            }
+            size_t newBoards = localSolutions.size() / puzzle.totalCells - boardsBefore;
+            progress.solutionCount += newBoards;
+            progress.solutionDigest += digestSolutions(puzzle, localSolutions.data() + boardsBefore * puzzle.totalCells, newBoards);
+            if (afterSlice) afterSlice();
+
+            if (status == SEARCH_PAUSED && checkpointsEnabled) {
+                if (preemptRequested) {
+                    saveCheckpoint();
+                    return SEARCH_PAUSED;
+                }
+                if (wallClockSeconds() - lastCheckpoint >= checkpoints.intervalSeconds) saveCheckpoint();
+            }
+        } while (status == SEARCH_PAUSED);
+
+        progress.completedUnits.push_back(i);
+        state = SearchState();
+
+        bool lastUnit = i + totalRanks >= totalStartingPlacements;
+        if (checkpointsEnabled && (lastUnit || wallClockSeconds() - lastCheckpoint >= checkpoints.intervalSeconds)) {
+            saveCheckpoint();
+        }
+    }
+    return SEARCH_FINISHED;
+}
+
+// Run searchAssignedPlacements with the narrowest mask that holds the board
+// (a single 64-bit word for the 11x5 board)
+SearchStatus searchAssignedPlacementsForBoard(const PuzzleTables &puzzle, int rankId, int totalRanks, const CheckpointOptions &checkpoints,
+                                              RankProgress &progress, std::vector<char> &localSolutions,
+                                              const std::function<void()> &afterSlice = std::function<void()>());
+
+#endif // IQFIT_CHECKPOINT_H
@@ -0,0 +1,370 @@
+// iqfit_compress.cpp
+// Solution path extraction, the range coder and the block format of solutions.iqz.
+
+#include "iqfit_compress.h"
+
+#include <algorithm>
+
+constexpr uint32_t COMPRESSED_VERSION = 1;
+constexpr int PROBABILITY_BITS = 11;
+constexpr uint16_t PROBABILITY_HALF = 1 << (PROBABILITY_BITS - 1);
+constexpr int ADAPT_SHIFT = 5;
+constexpr uint32_t RANGE_TOP = 1u << 24;
+// Bound on the boards a block holds per coded byte: every board codes at least one decision
+// (its shared-prefix length), and a saturated probability (2017/2048) still costs 0.022 bits,
+// so no block reaches 364 boards per byte
+constexpr uint64_t MAX_BOARDS_PER_BYTE = 512;
+
+static int bitsFor(size_t values) {
+    int bits = 1;
+    while ((size_t(1) << bits) < values) ++bits;
+    return bits;
+}
+
+static void appendU32(std::vector<char> &output, uint32_t value) {
+    for (int i = 0; i < 4; ++i) output.push_back(char(value >> (8 * i)));
+}
+
+static uint64_t readLittleEndian(const unsigned char *bytes, int count) {
+    uint64_t value = 0;
+    for (int i = count - 1; i >= 0; --i) value = (value << 8) | bytes[i];
+    return value;
+}
+
+SolutionCodecModels::SolutionCodecModels(const PuzzleTables &puzzle) {
+    size_t widestCandidates = 1;
+    for (const auto &byCell : puzzle.piecePlacementsByCell) {
+        for (const auto &candidates : byCell) widestCandidates = std::max(widestCandidates, candidates.size());
+    }
+    prefixBits = bitsFor(puzzle.totalPieces + 1);
+    pieceBits = bitsFor(puzzle.totalPieces);
+    candidateBits = bitsFor(widestCandidates);
+    // Bit trees: 2^bits probabilities per context (index 0 unused)
+    prefix.resize(size_t(1) << prefixBits);
+    pieces.resize((size_t(1) << pieceBits) * puzzle.totalCells);
+    candidates.resize((size_t(1) << candidateBits) * puzzle.totalPieces * puzzle.totalCells);
+    reset();
+}
+
+void SolutionCodecModels::reset() {
+    std::fill(prefix.begin(), prefix.end(), PROBABILITY_HALF);
+    std::fill(pieces.begin(), pieces.end(), PROBABILITY_HALF);
+    std::fill(candidates.begin(), candidates.end(), PROBABILITY_HALF);
+}
+
+// LZMA-style binary range encoder with adaptive probabilities
+class RangeEncoder {
+public:
+    explicit RangeEncoder(std::vector<char> &output) : output(output) {}
+
+    void encodeBit(uint16_t &probability, int bit) {
+        uint32_t bound = (range >> PROBABILITY_BITS) * probability;
+        if (bit == 0) {
+            range = bound;
+            probability += ((1 << PROBABILITY_BITS) - probability) >> ADAPT_SHIFT;
+        } else {
+            low += bound;
+            range -= bound;
+            probability -= probability >> ADAPT_SHIFT;
+        }
+        while (range < RANGE_TOP) {
+            range <<= 8;
+            shiftLow();
+        }
+    }
+
+    // Most significant bit first, each bit modelled by the path above it
+    void encodeTree(uint16_t *probabilities, int bits, uint32_t symbol) {
+        uint32_t node = 1;
+        for (int i = bits - 1; i >= 0; --i) {
+            int bit = (symbol >> i) & 1;
+            encodeBit(probabilities[node], bit);
+            node = (node << 1) | bit;
+        }
+    }
+
+    void flush() {
+        for (int i = 0; i < 5; ++i) shiftLow();
+    }
+
+private:
+    // Emit the top byte of low once no later carry can change it
+    void shiftLow() {
+        if (uint32_t(low) < 0xFF000000u || (low >> 32) != 0) {
+            unsigned char carry = low >> 32;
+            unsigned char pending = cache;
+            do {
+                output.push_back(char(pending + carry));
+                pending = 0xFF;
+            } while (--cacheSize != 0);
+            cache = (unsigned char)(low >> 24);
+        }
+        ++cacheSize;
+        low = (low & 0x00FFFFFFu) << 8;
+    }
+
+    std::vector<char> &output;
+    uint64_t low = 0;
+    uint32_t range = 0xFFFFFFFFu;
+    unsigned char cache = 0;
+    uint64_t cacheSize = 1;
+};
+
+void appendCompressedHeader(const PuzzleTables &puzzle, std::vector<char> &output) {
+    output.insert(output.end(), { 'I', 'Q', 'F', 'Z' });
+    appendU32(output, COMPRESSED_VERSION);
+    uint64_t fingerprint = puzzleFingerprint(puzzle);
+    appendU32(output, uint32_t(fingerprint));
+    appendU32(output, uint32_t(fingerprint >> 32));
+    appendU32(output, puzzle.totalCells);
+    appendU32(output, puzzle.totalPieces);
+}
+
+// Search path of a solved board: per step the piece on the first empty cell and the position
+// of its placement in that cell's candidate list
+static bool solutionPath(const PuzzleTables &puzzle, const char *board, std::vector<int> &pathCells,
+                         std::vector<std::pair<int,int>> &path, std::string &error) {
+    std::vector<char> filled(puzzle.totalCells, 0);
+    for (int cell : puzzle.blockedCells) filled[cell] = 1;
+    std::array<int, MAX_PIECES> pieceSize;
+    pieceSize.fill(0);
+    for (int cell = 0; cell < puzzle.totalCells; ++cell) {
+        int p = board[cell] - 'A';
+        if (p >= 0 && p < puzzle.totalPieces) ++pieceSize[p];
+    }
+
+    path.clear();
+    pathCells.clear();
+    int cell = 0;
+    for (int step = 0; step < puzzle.totalPieces; ++step) {
+        while (cell < puzzle.totalCells && filled[cell]) ++cell;
+        int p = cell < puzzle.totalCells ? board[cell] - 'A' : -1;
+        if (p < 0 || p >= puzzle.totalPieces) {
+            error = "board is not a complete solution of the puzzle";
+            return false;
+        }
+        const std::vector<int> &candidates = puzzle.piecePlacementsByCell[p][cell];
+        int found = -1;
+        for (size_t pos = 0; pos < candidates.size() && found < 0; ++pos) {
+            const std::vector<int> &cells = puzzle.piecePlacementCells[p][candidates[pos]];
+            if ((int)cells.size() != pieceSize[p]) continue;
+            bool matches = true;
+            for (int covered : cells) matches = matches && board[covered] == board[cell] && !filled[covered];
+            if (matches) found = pos;
+        }
+        if (found < 0) {
+            error = std::string("piece '") + board[cell] + "' does not match any of its placements";
+            return false;
+        }
+        for (int covered : puzzle.piecePlacementCells[p][candidates[found]]) filled[covered] = 1;
+        path.push_back(std::make_pair(p, found));
+        pathCells.push_back(cell);
+    }
+    if (std::count(filled.begin(), filled.end(), 0) != 0) {
+        error = "board is not a complete solution of the puzzle";
+        return false;
+    }
+    return true;
+}
+
+bool compressSolutions(const PuzzleTables &puzzle, const char *boards, size_t boardCount, std::vector<char> &output,
+                       std::string &error, size_t blockBoards) {
+    SolutionCodecModels models(puzzle);
+    std::vector<std::pair<int,int>> path, previousPath;
+    std::vector<int> pathCells;
+    const size_t pieceContext = size_t(1) << models.pieceBits, candidateContext = size_t(1) << models.candidateBits;
+
+    for (size_t first = 0; first < boardCount; first += blockBoards) {
+        size_t count = std::min(blockBoards, boardCount - first);
+        std::vector<char> coded;
+        RangeEncoder encoder(coded);
+        models.reset();
+        previousPath.clear();
+        for (size_t s = first; s < first + count; ++s) {
+            if (!solutionPath(puzzle, boards + s * puzzle.totalCells, pathCells, path, error)) return false;
+            size_t shared = 0;
+            while (shared < previousPath.size() && previousPath[shared] == path[shared]) ++shared;
+            encoder.encodeTree(models.prefix.data(), models.prefixBits, shared);
+            for (size_t step = shared; step < path.size(); ++step) {
+                int cell = pathCells[step], p = path[step].first;
+                encoder.encodeTree(&models.pieces[cell * pieceContext], models.pieceBits, p);
+                encoder.encodeTree(&models.candidates[(size_t(p) * puzzle.totalCells + cell) * candidateContext],
+                                   models.candidateBits, path[step].second);
+            }
+            previousPath.swap(path);
+        }
+        encoder.flush();
+        appendU32(output, count);
+        appendU32(output, coded.size());
+        output.insert(output.end(), coded.begin(), coded.end());
+    }
+    return true;
+}
+
+CompressedBlockDecoder::CompressedBlockDecoder(const PuzzleTables &puzzle)
+    : puzzle(puzzle), models(puzzle), boardAtDepth(puzzle.totalPieces + 1), cellAtDepth(puzzle.totalPieces, 0) {
+    boardAtDepth[0].assign(puzzle.totalCells, '.');
+    for (int cell : puzzle.blockedCells) boardAtDepth[0][cell] = '#';
+}
+
+void CompressedBlockDecoder::start(const unsigned char *blockBytes, size_t blockSize, size_t boardCount) {
+    bytes = blockBytes;
+    size = blockSize;
+    pos = 0;
+    boardsLeft = boardCount;
+    firstBoard = true;
+    corrupt = false;
+    range = 0xFFFFFFFFu;
+    code = 0;
+    for (int i = 0; i < 5; ++i) code = (code << 8) | nextByte();
+    models.reset();
+}
+
+int CompressedBlockDecoder::decodeBit(uint16_t &probability) {
+    uint32_t bound = (range >> PROBABILITY_BITS) * probability;
+    int bit;
+    if (code < bound) {
+        range = bound;
+        probability += ((1 << PROBABILITY_BITS) - probability) >> ADAPT_SHIFT;
+        bit = 0;
+    } else {
+        code -= bound;
+        range -= bound;
+        probability -= probability >> ADAPT_SHIFT;
+        bit = 1;
+    }
+    while (range < RANGE_TOP) {
+        range <<= 8;
+        code = (code << 8) | nextByte();
+    }
+    return bit;
+}
+
+int CompressedBlockDecoder::decodeTree(uint16_t *probabilities, int bits) {
+    uint32_t node = 1;
+    for (int i = 0; i < bits; ++i) node = (node << 1) | decodeBit(probabilities[node]);
+    return node - (1u << bits);
+}
+
+bool CompressedBlockDecoder::next(const char *&board) {
+    if (boardsLeft == 0 || corrupt) return false;
+    --boardsLeft;
+
+    const int pieces = puzzle.totalPieces;
+    const size_t pieceContext = size_t(1) << models.pieceBits, candidateContext = size_t(1) << models.candidateBits;
+    int shared = decodeTree(models.prefix.data(), models.prefixBits);
+    if (shared > pieces || (firstBoard && shared != 0)) {
+        corrupt = true;
+        return false;
+    }
+    firstBoard = false;
+    // Steps below the shared prefix are the previous solution's; rebuild the rest
+    for (int step = shared; step < pieces; ++step) {
+        const BoardRepresentation &before = boardAtDepth[step];
+        int cell = step == 0 ? 0 : cellAtDepth[step - 1];
+        while (cell < puzzle.totalCells && before[cell] != '.') ++cell;
+        if (cell >= puzzle.totalCells) {
+            corrupt = true;
+            return false;
+        }
+        int p = decodeTree(&models.pieces[size_t(cell) * pieceContext], models.pieceBits);
+        int pos = p < pieces ? decodeTree(&models.candidates[(size_t(p) * puzzle.totalCells + cell) * candidateContext], models.candidateBits) : 0;
+        if (p >= pieces || pos >= (int)puzzle.piecePlacementsByCell[p][cell].size()) {
+            corrupt = true;
+            return false;
+        }
+        boardAtDepth[step + 1] = before;
+        for (int covered : puzzle.piecePlacementCells[p][puzzle.piecePlacementsByCell[p][cell][pos]]) {
+            boardAtDepth[step + 1][covered] = char('A' + p);
+        }
+        cellAtDepth[step] = cell;
+    }
+    // The last board ends exactly at the end of the encoder's flush bytes
+    if (corrupt || (boardsLeft == 0 && pos != size)) {
+        corrupt = true;
+        return false;
+    }
+    board = boardAtDepth[pieces].data();
+    return true;
+}
+
+bool decodeCompressedBlock(const PuzzleTables &puzzle, const unsigned char *bytes, size_t size, size_t boardCount,
+                           std::vector<char> &boards, std::string &error) {
+    CompressedBlockDecoder decoder(puzzle);
+    decoder.start(bytes, size, boardCount);
+    const char *board;
+    while (decoder.next(board)) boards.insert(boards.end(), board, board + puzzle.totalCells);
+    if (decoder.failed()) {
+        error = "corrupt block";
+        return false;
+    }
+    return true;
+}
+
+CompressedSolutionReader::CompressedSolutionReader(const PuzzleTables &puzzle) : puzzle(puzzle), decoder(puzzle) {}
+
+bool CompressedSolutionReader::open(const std::string &path, std::string &error) {
+    input.open(path, std::ios::binary);
+    if (!input) {
+        error = "cannot open " + path;
+        return false;
+    }
+    input.seekg(0, std::ios::end);
+    fileSize = input.tellg();
+    input.seekg(0, std::ios::beg);
+    unsigned char header[24];
+    if (!input.read(reinterpret_cast<char *>(header), sizeof(header)) || std::string(header, header + 4) != "IQFZ") {
+        error = path + " is not a compressed solution file";
+        return false;
+    }
+    if (readLittleEndian(header + 4, 4) != COMPRESSED_VERSION) {
+        error = path + " has an unsupported version";
+        return false;
+    }
+    if (readLittleEndian(header + 8, 8) != puzzleFingerprint(puzzle) || readLittleEndian(header + 16, 4) != (uint64_t)puzzle.totalCells ||
+        readLittleEndian(header + 20, 4) != (uint64_t)puzzle.totalPieces) {
+        error = path + " was written for a different puzzle (use the same --puzzle)";
+        return false;
+    }
+    return true;
+}
+
+bool CompressedSolutionReader::readBlock(std::vector<unsigned char> &bytes, size_t &boardCount) {
+    if (!failure.empty()) return false;
+    unsigned char sizes[8];
+    if (!input.read(reinterpret_cast<char *>(sizes), sizeof(sizes))) {
+        if (input.gcount() != 0) failure = "truncated block header";
+        return false;
+    }
+    boardCount = readLittleEndian(sizes, 4);
+    uint64_t byteCount = readLittleEndian(sizes + 4, 4);
+    if (boardCount == 0 || boardCount > byteCount * MAX_BOARDS_PER_BYTE) {
+        failure = "corrupt block header";
+        return false;
+    }
+    // Check the size against the rest of the file before allocating it
+    std::streamoff here = input.tellg();
+    if (here < 0 || (uint64_t)(fileSize - here) < byteCount) {
+        failure = "truncated block";
+        return false;
+    }
+    bytes.resize(byteCount);
+    if (!input.read(reinterpret_cast<char *>(bytes.data()), bytes.size())) {
+        failure = "truncated block";
+        return false;
+    }
+    return true;
+}
+
+bool CompressedSolutionReader::next(const char *&board) {
+    while (!decoder.next(board)) {
+        if (decoder.failed()) {
+            failure = "corrupt block";
+            return false;
+        }
+        size_t boardCount;
+        if (!readBlock(block, boardCount)) return false;
+        decoder.start(block.data(), block.size(), boardCount);
+    }
+    return true;
+}
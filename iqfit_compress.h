@@ -0,0 +1,115 @@
+// iqfit_compress.h
+// Compressed solution files (solutions.iqz). A solution is stored as its search path: at each
+// step the first empty cell, the piece covering it and that placement's position in the
+// piece's candidate list for the cell. Consecutive solutions in search order share long path
+// prefixes, so each one is coded as the length of the prefix it shares with the previous one
+// plus its new steps, and an adaptive binary range coder (LZMA style, with the depth and the
+// piece as contexts) squeezes out the rest.
+//
+// File layout (integers little-endian):
+//   "IQFZ", version u32, puzzle fingerprint u64, totalCells u32, totalPieces u32
+//   blocks: boardCount u32, byteCount u32, range-coded bytes
+// Blocks are self-contained (fresh models, no shared prefix across blocks), so every rank or
+// thread compresses its own boards and the blocks are simply concatenated in rank order.
+
+#ifndef IQFIT_COMPRESS_H
+#define IQFIT_COMPRESS_H
+
+#include "iqfit_core.h"
+
+#include <fstream>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Boards per block when a caller does not choose
+constexpr size_t COMPRESSED_BLOCK_BOARDS = 1 << 18;
+
+// Append the file header for this puzzle
+void appendCompressedHeader(const PuzzleTables &puzzle, std::vector<char> &output);
+
+// Encode boards (row-major, totalCells characters each, ideally in search order) as blocks of
+// at most blockBoards boards appended to output. Fails on a board that is not a complete
+// solution of the puzzle.
+bool compressSolutions(const PuzzleTables &puzzle, const char *boards, size_t boardCount, std::vector<char> &output,
+                       std::string &error, size_t blockBoards = COMPRESSED_BLOCK_BOARDS);
+
+// Adaptive bit models shared by the encoder and the decoder: the shared-prefix length, the
+// piece at each branch cell and the candidate position for each (piece, cell)
+struct SolutionCodecModels {
+    int prefixBits, pieceBits, candidateBits;
+    std::vector<uint16_t> prefix, pieces, candidates;
+
+    explicit SolutionCodecModels(const PuzzleTables &puzzle);
+    void reset();
+};
+
+// Decoder for one block (fresh models, as written by compressSolutions)
+class CompressedBlockDecoder {
+public:
+    explicit CompressedBlockDecoder(const PuzzleTables &puzzle);
+
+    // Decode from these bytes (kept by the caller) until boardCount boards are out
+    void start(const unsigned char *bytes, size_t size, size_t boardCount);
+
+    // Next board (valid until the following call); false at the end of the block or on
+    // corrupt data, which failed() then tells apart
+    bool next(const char *&board);
+
+    bool failed() const { return corrupt; }
+
+private:
+    // The decoder reads exactly the bytes the encoder wrote, so running past them means the
+    // block is corrupt (for example a board count larger than the one encoded)
+    unsigned char nextByte() {
+        if (pos < size) return bytes[pos++];
+        corrupt = true;
+        return 0;
+    }
+    int decodeBit(uint16_t &probability);
+    int decodeTree(uint16_t *probabilities, int bits);
+
+    const PuzzleTables &puzzle;
+    const unsigned char *bytes = nullptr;
+    size_t size = 0, pos = 0, boardsLeft = 0;
+    bool firstBoard = true, corrupt = false;
+    uint32_t range = 0, code = 0;
+    SolutionCodecModels models;
+
+    // Previous solution's path: boards before each step and the cell each step covered
+    std::vector<BoardRepresentation> boardAtDepth;
+    std::vector<int> cellAtDepth;
+};
+
+// Append the boards of one block to boards
+bool decodeCompressedBlock(const PuzzleTables &puzzle, const unsigned char *bytes, size_t size, size_t boardCount,
+                           std::vector<char> &boards, std::string &error);
+
+// Streaming decoder: reads one block at a time and rebuilds one board per call
+class CompressedSolutionReader {
+public:
+    explicit CompressedSolutionReader(const PuzzleTables &puzzle);
+
+    // Open a file and check its header against the puzzle
+    bool open(const std::string &path, std::string &error);
+
+    // Next board (valid until the following call); false at the end of the file or on an
+    // error, which is then left in error()
+    bool next(const char *&board);
+
+    // The next block undecoded, for decoding elsewhere (e.g. on another thread); false at the
+    // end of the file or on an error. Do not mix with next().
+    bool readBlock(std::vector<unsigned char> &bytes, size_t &boardCount);
+
+    const std::string &error() const { return failure; }
+
+private:
+    const PuzzleTables &puzzle;
+    std::ifstream input;
+    std::streamoff fileSize = 0;
+    std::string failure;
+    std::vector<unsigned char> block;
+    CompressedBlockDecoder decoder;
+};
+
+#endif // IQFIT_COMPRESS_H
@@ -0,0 +1,459 @@
+// iqfit_convert.cpp
+// Converts solution files between formats in a streaming pipeline with bounded memory:
+//
+//   text        solutions.txt layout (.txt)
+//   packed      placement index of every piece, per board (.iqp)
+//   compressed  the --compress stream (.iqz)
+//   dag         solution DAG built by iqfit_dag (.dag, input only: a DAG holds a whole
+//               solution set and is built by searching, not from a list of boards)
+//
+// The main thread reads the input in batches (a few MB of text, a run of packed records, one
+// compressed block, or a run of boards listed from the DAG). Worker threads decode each batch
+// to boards and encode it for the output, and a writer thread writes the results in input
+// order. At most a fixed number of batches is in flight, so files larger than memory convert
+// in constant space. Boards are mapped to placement indices through PlacementLookup (a hash
+// from each piece's cell mask to its placement).
+//
+// Packed layout (integers little-endian):
+//   "IQFP", version u32, puzzle fingerprint u64, totalCells u32, totalPieces u32, indexBytes u32
+//   per board: the placement index of piece A, B, ... (indexBytes bytes each)
+
+#include "iqfit_core.h"
+#include "iqfit_compress.h"
+#include "iqfit_dag.h"
+#include "iqfit_validate.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <new>
+
+enum SolutionFormat { FORMAT_UNKNOWN, FORMAT_TEXT, FORMAT_PACKED, FORMAT_COMPRESSED, FORMAT_DAG };
+
+constexpr uint32_t PACKED_VERSION = 1;
+constexpr size_t TEXT_BATCH_BYTES = 4u << 20;
+constexpr size_t TEXT_CARRY_LIMIT = 4 * TEXT_BATCH_BYTES;   // text held without finding a blank line
+constexpr size_t BOARD_BATCH = 65536;
+
+static SolutionFormat parseFormat(const std::string &name) {
+    if (name == "text") return FORMAT_TEXT;
+    if (name == "packed") return FORMAT_PACKED;
+    if (name == "compressed") return FORMAT_COMPRESSED;
+    if (name == "dag") return FORMAT_DAG;
+    return FORMAT_UNKNOWN;
+}
+
+static SolutionFormat formatOfPath(const std::string &path) {
+    size_t dot = path.rfind('.');
+    std::string extension = dot == std::string::npos ? "" : path.substr(dot);
+    if (extension == ".txt") return FORMAT_TEXT;
+    if (extension == ".iqp") return FORMAT_PACKED;
+    if (extension == ".iqz") return FORMAT_COMPRESSED;
+    if (extension == ".dag") return FORMAT_DAG;
+    return FORMAT_UNKNOWN;
+}
+
+static void appendLittleEndian(std::vector<char> &output, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) output.push_back(char(value >> (8 * i)));
+}
+
+static uint64_t readLittleEndian(const unsigned char *bytes, int count) {
+    uint64_t value = 0;
+    for (int i = count - 1; i >= 0; --i) value = (value << 8) | bytes[i];
+    return value;
+}
+
+// Two bytes per index unless some piece has more placements than that holds
+static int packedIndexBytes(const PuzzleTables &puzzle) {
+    for (const auto &placements : puzzle.piecePlacementCells) {
+        if (placements.size() > 0xFFFF) return 4;
+    }
+    return 2;
+}
+
+static std::vector<char> packedHeader(const PuzzleTables &puzzle) {
+    std::vector<char> header = { 'I', 'Q', 'F', 'P' };
+    appendLittleEndian(header, PACKED_VERSION, 4);
+    appendLittleEndian(header, puzzleFingerprint(puzzle), 8);
+    appendLittleEndian(header, puzzle.totalCells, 4);
+    appendLittleEndian(header, puzzle.totalPieces, 4);
+    appendLittleEndian(header, packedIndexBytes(puzzle), 4);
+    return header;
+}
+
+// One unit of work: raw input bytes in, encoded output bytes out
+struct Batch {
+    size_t sequence = 0;
+    std::vector<unsigned char> raw;     // text, packed records or one compressed block
+    size_t rawBoards = 0;               // boards in a compressed block
+    std::vector<char> boards;           // decoded boards (filled directly for DAG input)
+    std::vector<char> output;
+    unsigned long long boardCount = 0, digest = 0;
+    std::string error;
+};
+
+class ConversionPipeline {
+public:
+    ConversionPipeline(const PuzzleTables &puzzle, SolutionFormat from, SolutionFormat to, int threads, std::ofstream &output)
+        : puzzle(puzzle), lookup(puzzle), from(from), to(to), threads(threads), output(output),
+          maxInFlight(2 * threads + 2) {
+        for (int t = 0; t < threads; ++t) workers.emplace_back(&ConversionPipeline::workerLoop, this);
+        writer = std::thread(&ConversionPipeline::writerLoop, this);
+    }
+
+    // Queue a batch; waits while too many are in flight. False once the conversion has failed.
+    bool submit(Batch &&batch) {
+        std::unique_lock<std::mutex> guard(lock);
+        changed.wait(guard, [&]() { return inFlight < maxInFlight || !failure.empty(); });
+        if (!failure.empty()) return false;
+        batch.sequence = submitted++;
+        ++inFlight;
+        pending.push_back(std::move(batch));
+        changed.notify_all();
+        return true;
+    }
+
+    // Wait for every batch to be written and stop the threads
+    bool finish(unsigned long long &boards, unsigned long long &digest, std::string &error) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            inputDone = true;
+            changed.notify_all();
+        }
+        for (auto &worker : workers) worker.join();
+        writer.join();
+        boards = totalBoards;
+        digest = totalDigest;
+        error = failure;
+        return failure.empty();
+    }
+
+    void fail(const std::string &error) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (failure.empty()) failure = error;
+        changed.notify_all();
+    }
+
+private:
+    void workerLoop() {
+        while (true) {
+            Batch batch;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                changed.wait(guard, [&]() { return !pending.empty() || inputDone || !failure.empty(); });
+                if (pending.empty() || !failure.empty()) return;
+                batch = std::move(pending.front());
+                pending.erase(pending.begin());
+            }
+            // An exception must not escape the thread (std::terminate would leave the output behind)
+            try {
+                convert(batch);
+            } catch (const std::bad_alloc &) {
+                batch.error = "out of memory";
+            } catch (const std::exception &e) {
+                batch.error = e.what();
+            } catch (...) {
+                batch.error = "unexpected error";
+            }
+            std::lock_guard<std::mutex> guard(lock);
+            if (!batch.error.empty() && failure.empty()) failure = batch.error;
+            finished.emplace(batch.sequence, std::move(batch));
+            changed.notify_all();
+        }
+    }
+
+    void convert(Batch &batch) {
+        std::string &error = batch.error;
+        if (from == FORMAT_TEXT) {
+            parseBoardsText(reinterpret_cast<const char *>(batch.raw.data()), batch.raw.size(), puzzle, batch.boards, error);
+        } else if (from == FORMAT_PACKED) {
+            decodePacked(batch);
+        } else if (from == FORMAT_COMPRESSED) {
+            decodeCompressedBlock(puzzle, batch.raw.data(), batch.raw.size(), batch.rawBoards, batch.boards, error);
+        }
+        std::vector<unsigned char>().swap(batch.raw);
+        if (!error.empty()) return;
+
+        batch.boardCount = batch.boards.size() / puzzle.totalCells;
+        batch.digest = digestSolutions(puzzle, batch.boards.data(), batch.boardCount);
+        if (to == FORMAT_TEXT) {
+            batch.output.resize(batch.boardCount * boardTextBytes(puzzle));
+            formatBoardsAsText(puzzle, batch.boards.data(), batch.boardCount, batch.output.data());
+        } else if (to == FORMAT_PACKED) {
+            encodePacked(batch);
+        } else {
+            // One self-contained block per batch
+            compressSolutions(puzzle, batch.boards.data(), batch.boardCount, batch.output, error, std::max<size_t>(1, batch.boardCount));
+        }
+        std::vector<char>().swap(batch.boards);
+    }
+
+    void decodePacked(Batch &batch) {
+        const int indexBytes = packedIndexBytes(puzzle);
+        const size_t recordBytes = size_t(indexBytes) * puzzle.totalPieces;
+        batch.boards.reserve(batch.raw.size() / recordBytes * puzzle.totalCells);
+        BoardRepresentation board(puzzle.totalCells);
+        for (size_t offset = 0; offset + recordBytes <= batch.raw.size(); offset += recordBytes) {
+            std::fill(board.begin(), board.end(), '.');
+            for (int cell : puzzle.blockedCells) board[cell] = '#';
+            for (int p = 0; p < puzzle.totalPieces; ++p) {
+                uint64_t placement = readLittleEndian(&batch.raw[offset + size_t(p) * indexBytes], indexBytes);
+                if (placement >= puzzle.piecePlacementCells[p].size()) {
+                    batch.error = "packed record holds placement " + std::to_string(placement) + " for piece " + char('A' + p);
+                    return;
+                }
+                for (int cell : puzzle.piecePlacementCells[p][placement]) board[cell] = char('A' + p);
+            }
+            batch.boards.insert(batch.boards.end(), board.begin(), board.end());
+        }
+    }
+
+    void encodePacked(Batch &batch) {
+        const int indexBytes = packedIndexBytes(puzzle);
+        std::vector<int> placements;
+        std::string reason;
+        batch.output.reserve(batch.boardCount * indexBytes * puzzle.totalPieces);
+        for (size_t s = 0; s < batch.boardCount; ++s) {
+            if (!lookup.placementsOf(&batch.boards[s * puzzle.totalCells], placements, reason)) {
+                batch.error = "board is not a solution: " + reason;
+                return;
+            }
+            for (int placement : placements) appendLittleEndian(batch.output, placement, indexBytes);
+        }
+    }
+
+    // Writes batches in input order as they complete
+    void writerLoop() {
+        size_t next = 0;
+        while (true) {
+            Batch batch;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                changed.wait(guard, [&]() { return finished.count(next) || !failure.empty() || (inputDone && next == submitted); });
+                if (!failure.empty() || !finished.count(next)) return;
+                batch = std::move(finished[next]);
+                finished.erase(next);
+            }
+            output.write(batch.output.data(), batch.output.size());
+            std::lock_guard<std::mutex> guard(lock);
+            if (!output && failure.empty()) failure = "write failed";
+            totalBoards += batch.boardCount;
+            totalDigest += batch.digest;
+            --inFlight;
+            ++next;
+            changed.notify_all();
+        }
+    }
+
+    const PuzzleTables &puzzle;
+    PlacementLookup lookup;
+    SolutionFormat from, to;
+    int threads;
+    std::ofstream &output;
+    size_t maxInFlight;
+
+    std::vector<std::thread> workers;
+    std::thread writer;
+    std::mutex lock;
+    std::condition_variable changed;
+    std::vector<Batch> pending;
+    std::map<size_t, Batch> finished;
+    size_t submitted = 0, inFlight = 0;
+    bool inputDone = false;
+    std::string failure;
+    unsigned long long totalBoards = 0, totalDigest = 0;
+};
+
+// Text in chunks of a few MB, each cut after the last blank line it holds ("\n\n", or
+// "\n\r\n" in CRLF files)
+static bool readText(std::ifstream &input, ConversionPipeline &pipeline, std::string &error) {
+    std::vector<unsigned char> carry;
+    while (true) {
+        size_t kept = carry.size();
+        carry.resize(kept + TEXT_BATCH_BYTES);
+        input.read(reinterpret_cast<char *>(carry.data() + kept), TEXT_BATCH_BYTES);
+        carry.resize(kept + input.gcount());
+        bool atEnd = input.gcount() == 0;
+        size_t cut = carry.size();
+        if (!atEnd) {
+            cut = 0;
+            for (size_t i = carry.size(); i >= 2; --i) {
+                if (carry[i - 1] != '\n') continue;
+                if (carry[i - 2] == '\n' || (i >= 3 && carry[i - 2] == '\r' && carry[i - 3] == '\n')) {
+                    cut = i;
+                    break;
+                }
+            }
+            if (cut == 0) {
+                // No board boundary yet: read more, but not without bound
+                if (carry.size() > TEXT_CARRY_LIMIT) {
+                    error = "no blank line between boards in " + std::to_string(TEXT_CARRY_LIMIT >> 20) + " MB of text";
+                    return false;
+                }
+                continue;
+            }
+        }
+        if (cut > 0) {
+            Batch batch;
+            batch.raw.assign(carry.begin(), carry.begin() + cut);
+            carry.erase(carry.begin(), carry.begin() + cut);
+            if (!pipeline.submit(std::move(batch))) return false;
+        }
+        if (atEnd) return true;
+    }
+}
+
+static bool readPacked(std::ifstream &input, const PuzzleTables &puzzle, ConversionPipeline &pipeline, std::string &error) {
+    std::vector<char> expected = packedHeader(puzzle);
+    std::vector<char> header(expected.size());
+    if (!input.read(header.data(), header.size()) || std::string(header.data(), 4) != "IQFP") {
+        error = "not a packed solution file";
+        return false;
+    }
+    if (header != expected) {
+        error = "packed file was written for a different puzzle or version (use the same --puzzle)";
+        return false;
+    }
+    const size_t recordBytes = size_t(packedIndexBytes(puzzle)) * puzzle.totalPieces;
+    while (true) {
+        Batch batch;
+        batch.raw.resize(BOARD_BATCH * recordBytes);
+        input.read(reinterpret_cast<char *>(batch.raw.data()), batch.raw.size());
+        batch.raw.resize(input.gcount());
+        if (batch.raw.size() % recordBytes != 0) {
+            error = "packed file ends inside a record";
+            return false;
+        }
+        if (batch.raw.empty()) return true;
+        if (!pipeline.submit(std::move(batch))) return false;
+    }
+}
+
+static bool readCompressed(const std::string &path, const PuzzleTables &puzzle, ConversionPipeline &pipeline, std::string &error) {
+    CompressedSolutionReader reader(puzzle);
+    if (!reader.open(path, error)) return false;
+    while (true) {
+        Batch batch;
+        if (!reader.readBlock(batch.raw, batch.rawBoards)) break;
+        if (!pipeline.submit(std::move(batch))) return false;
+    }
+    error = reader.error();
+    return error.empty();
+}
+
+static bool readDag(const std::string &path, const PuzzleTables &puzzle, ConversionPipeline &pipeline, std::string &error) {
+    SolutionDag dag(puzzle);
+    if (!dag.load(path, error)) return false;
+    Batch batch;
+    bool accepted = true;
+    dag.forEachSolution([&](const char *board) {
+        batch.boards.insert(batch.boards.end(), board, board + puzzle.totalCells);
+        if (batch.boards.size() == BOARD_BATCH * puzzle.totalCells) {
+            accepted = pipeline.submit(std::move(batch));
+            batch = Batch();
+        }
+        return accepted;
+    });
+    return accepted && (batch.boards.empty() || pipeline.submit(std::move(batch)));
+}
+
+int main(int argc, char **argv) {
+    std::string puzzlePath, inputPath, outputPath;
+    SolutionFormat from = FORMAT_UNKNOWN, to = FORMAT_UNKNOWN;
+    int threads = 0;
+    bool usable = true;
+    for (int i = 1; i < argc && usable; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--puzzle" && i + 1 < argc) {
+            puzzlePath = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::atoi(argv[++i]);
+        } else if (arg == "--from" && i + 1 < argc) {
+            usable = (from = parseFormat(argv[++i])) != FORMAT_UNKNOWN;
+        } else if (arg == "--to" && i + 1 < argc) {
+            usable = (to = parseFormat(argv[++i])) != FORMAT_UNKNOWN;
+        } else if (!arg.empty() && arg[0] != '-' && inputPath.empty()) {
+            inputPath = arg;
+        } else if (!arg.empty() && arg[0] != '-' && outputPath.empty()) {
+            outputPath = arg;
+        } else {
+            usable = false;
+        }
+    }
+    if (from == FORMAT_UNKNOWN) from = formatOfPath(inputPath);
+    if (to == FORMAT_UNKNOWN) to = formatOfPath(outputPath);
+    if (!usable || outputPath.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [--puzzle <file>] [--threads <count>]"
+                  << " [--from <format>] [--to <format>] <input> <output>\n"
+                  << "  formats: text (.txt), packed (.iqp), compressed (.iqz), dag (.dag, input only)\n";
+        return 1;
+    }
+    if (from == FORMAT_UNKNOWN || to == FORMAT_UNKNOWN || to == FORMAT_DAG) {
+        std::cerr << "Error: " << (to == FORMAT_DAG ? "a DAG is built with iqfit_dag, not converted to"
+                                                    : "cannot tell the format from the extension; use --from/--to") << "\n";
+        return 1;
+    }
+    if (inputPath == outputPath) {
+        std::cerr << "Error: input and output are the same file\n";
+        return 1;
+    }
+    if (threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    PuzzleTables puzzle;
+    std::string error;
+    if (!puzzlePath.empty() && !loadPuzzleDefinition(puzzlePath, puzzle, error)) {
+        std::cerr << "Error: " << error << "\n";
+        return 1;
+    }
+    double startTime = wallClockSeconds();
+    precomputeAllPiecePlacements(puzzle);
+
+    std::ifstream input;
+    if (from != FORMAT_COMPRESSED && from != FORMAT_DAG) {
+        input.open(inputPath, std::ios::binary);
+        if (!input) {
+            std::cerr << "Error: cannot open " << inputPath << "\n";
+            return 1;
+        }
+    }
+    std::ofstream output(outputPath, std::ios::binary);
+    if (!output) {
+        std::cerr << "Error: cannot open " << outputPath << "\n";
+        return 1;
+    }
+    std::vector<char> header;
+    if (to == FORMAT_PACKED) header = packedHeader(puzzle);
+    if (to == FORMAT_COMPRESSED) appendCompressedHeader(puzzle, header);
+    output.write(header.data(), header.size());
+
+    unsigned long long boards = 0, digest = 0;
+    bool converted;
+    {
+        ConversionPipeline pipeline(puzzle, from, to, threads, output);
+        bool readAll = true;
+        if (from == FORMAT_TEXT) readAll = readText(input, pipeline, error);
+        else if (from == FORMAT_PACKED) readAll = readPacked(input, puzzle, pipeline, error);
+        else if (from == FORMAT_COMPRESSED) readAll = readCompressed(inputPath, puzzle, pipeline, error);
+        else readAll = readDag(inputPath, puzzle, pipeline, error);
+        if (!readAll && !error.empty()) pipeline.fail(error);
+        converted = pipeline.finish(boards, digest, error);
+    }
+    output.close();
+    if (!converted || !output) {
+        std::cerr << "Error: " << inputPath << ": " << (error.empty() ? "cannot write " + outputPath : error) << "\n";
+        std::remove(outputPath.c_str());
+        return 1;
+    }
+    printSolutionTotals(boards, digest);
+    std::cout << "Elapsed time: " << (wallClockSeconds() - startTime) << " seconds\n";
+    return 0;
+}
@@ -0,0 +1,466 @@
+// iqfit_core.cpp
+// Puzzle definition parsing, placement table generation, digests and text output.
+
+#include "iqfit_core.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <set>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+std::vector<std::string> standardPieceShapes() {
+    return {
+        "01 10 11 21 31", "01 10 11 21 22", "10 11 12 13 03",
+        "01 11 10 02", "00 01 02 12 13", "02 12 11 21 20",
+        "02 12 11 10", "02 12 22 21 20", "01 11 10",
+        "01 02 11 12 10", "01 11 10 21", "00 01 11 21 20"
+    };
+}
+
+volatile std::sig_atomic_t preemptRequested = 0;
+
+// Decode one coordinate digit: '0'-'9' then 'a'-'z' (or 'A'-'Z') for 10-35
+static int parseCoordinateDigit(char digit) {
+    if (digit >= '0' && digit <= '9') return digit - '0';
+    if (digit >= 'a' && digit <= 'z') return digit - 'a' + 10;
+    if (digit >= 'A' && digit <= 'Z') return digit - 'A' + 10;
+    return -1;
+}
+
+// Parse a piece shape string into a list of coordinate pairs
+std::vector<std::pair<int,int>> parsePieceShape(const std::string &shapeStr) {
+    std::vector<std::pair<int,int>> coordinates;
+    std::istringstream tokens(shapeStr);
+    std::string token;
+    while (tokens >> token) {
+        int x = token.size() == 2 ? parseCoordinateDigit(token[0]) : -1;
+        int y = token.size() == 2 ? parseCoordinateDigit(token[1]) : -1;
+        if (x < 0 || y < 0) return {};
+        coordinates.emplace_back(x, y);
+    }
+    return coordinates;
+}
+
+// Split a piece definition into its alternative footprints (forms); an empty form before,
+// between or after the '|' separators is kept so the caller can reject it
+std::vector<std::string> splitPieceForms(const std::string &shapeStr) {
+    std::vector<std::string> forms;
+    size_t start = 0;
+    while (true) {
+        size_t bar = shapeStr.find('|', start);
+        forms.push_back(shapeStr.substr(start, bar == std::string::npos ? std::string::npos : bar - start));
+        if (bar == std::string::npos) return forms;
+        start = bar + 1;
+    }
+}
+
+// Read board size, blocked cells and piece shapes from a puzzle definition.
+// Format (one directive per line, '#' starts a comment, coordinates use the "xy" notation):
+//   board <width> <height>
+//   blocked <xy> <xy> ...
+//   row <cells>                (optional map of the play area, one line per board row:
+//                               '.' = open cell, 'x' = blocked; sets the board size)
+//   piece <xy> <xy> ...        (one line per piece, labelled A, B, C, ... in file order)
+//   piece <xy> ... | <xy> ...  (a piece with several faces; each piece is still used once)
+// The puzzle is only changed when the whole definition is valid.
+bool parsePuzzleDefinition(std::istream &input, const std::string &path, PuzzleTables &puzzle, std::string &error) {
+    int width = 0, height = 0;
+    std::vector<std::string> shapes;
+    std::vector<std::pair<int,int>> blockedCoords;
+    std::vector<std::string> mapRows;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(input, line)) {
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        std::string directive;
+        if (!(fields >> directive)) continue;
+
+        std::string rest;
+        std::getline(fields, rest);
+        std::string where = path + ":" + std::to_string(lineNumber) + ": ";
+        if (directive == "board") {
+            std::istringstream size(rest);
+            if (!(size >> width >> height) || width <= 0 || height <= 0) {
+                error = where + "expected 'board <width> <height>'";
+                return false;
+            }
+        } else if (directive == "blocked") {
+            auto coords = parsePieceShape(rest);
+            if (coords.empty()) {
+                error = where + "expected 'blocked <xy> ...'";
+                return false;
+            }
+            blockedCoords.insert(blockedCoords.end(), coords.begin(), coords.end());
+        } else if (directive == "row") {
+            std::string cells;
+            std::istringstream rowFields(rest);
+            if (!(rowFields >> cells) || cells.find_first_not_of(".x") != std::string::npos) {
+                error = where + "expected 'row <cells>' made of '.' and 'x'";
+                return false;
+            }
+            mapRows.push_back(cells);
+        } else if (directive == "piece") {
+            for (const auto &form : splitPieceForms(rest)) {
+                auto coords = parsePieceShape(form);
+                if (coords.empty()) {
+                    error = where + "expected 'piece <xy> ... [| <xy> ...]'";
+                    return false;
+                }
+                std::set<std::pair<int,int>> distinct(coords.begin(), coords.end());
+                if (distinct.size() != coords.size()) {
+                    error = where + "piece form lists a cell more than once";
+                    return false;
+                }
+            }
+            shapes.push_back(rest);
+        } else {
+            error = where + "unknown directive '" + directive + "'";
+            return false;
+        }
+    }
+
+    // A row map describes irregular play areas; its 'x' cells join the blocked list
+    if (!mapRows.empty()) {
+        int mapWidth = mapRows[0].size();
+        for (const auto &row : mapRows) {
+            if ((int)row.size() != mapWidth) {
+                error = path + ": all map rows must have the same length";
+                return false;
+            }
+        }
+        if (width != 0 && (width != mapWidth || height != (int)mapRows.size())) {
+            error = path + ": map rows do not match the 'board' size";
+            return false;
+        }
+        width = mapWidth;
+        height = mapRows.size();
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                if (mapRows[y][x] == 'x') blockedCoords.emplace_back(x, y);
+            }
+        }
+    }
+
+    if (width == 0) {
+        error = path + ": missing 'board' directive or row map";
+        return false;
+    }
+    if (width * height > MAX_BOARD_CELLS) {
+        error = path + ": board has more than " + std::to_string(MAX_BOARD_CELLS) + " cells";
+        return false;
+    }
+    if (shapes.empty() || (int)shapes.size() > MAX_PIECES) {
+        error = path + ": expected between 1 and " + std::to_string(MAX_PIECES) + " pieces";
+        return false;
+    }
+
+    std::vector<int> cells;
+    for (const auto &coord : blockedCoords) {
+        if (coord.first >= width || coord.second >= height) {
+            error = path + ": blocked cell outside the board";
+            return false;
+        }
+        cells.push_back(coord.second * width + coord.first);
+    }
+    std::sort(cells.begin(), cells.end());
+    cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+
+    puzzle = PuzzleTables();
+    puzzle.boardWidth = width;
+    puzzle.boardHeight = height;
+    puzzle.totalCells = width * height;
+    puzzle.totalPieces = shapes.size();
+    puzzle.basePieceShapes = shapes;
+    puzzle.blockedCells = cells;
+    return true;
+}
+
+bool loadPuzzleDefinition(const std::string &path, PuzzleTables &puzzle, std::string &error) {
+    std::ifstream inputFile(path);
+    if (!inputFile.is_open()) {
+        error = "could not open " + path;
+        return false;
+    }
+    return parsePuzzleDefinition(inputFile, path, puzzle, error);
+}
+
+// Generate all unique orientations (rotations + reflections) of a piece
+static std::vector<std::vector<std::pair<int,int>>> generateUniqueOrientations(const std::vector<std::pair<int,int>> &baseCoords) {
+    std::set<std::vector<std::pair<int,int>>> uniqueOrientations;
+    for (int reflect = 0; reflect < 2; ++reflect) {
+        for (int rot = 0; rot < 4; ++rot) {
+            std::vector<std::pair<int,int>> transformed;
+            for (const auto &coord : baseCoords) {
+                int x = reflect ? -coord.first : coord.first;
+                int y = coord.second;
+                for (int r = 0; r < rot; ++r) {
+                    int temp = x;
+                    x = y;
+                    y = -temp;
+                }
+                transformed.emplace_back(x, y);
+            }
+            // Normalize to top-left origin
+            int minX = INT32_MAX, minY = INT32_MAX;
+            for (const auto &p : transformed) {
+                minX = std::min(minX, p.first);
+                minY = std::min(minY, p.second);
+            }
+            for (auto &p : transformed) {
+                p.first -= minX;
+                p.second -= minY;
+            }
+            std::sort(transformed.begin(), transformed.end());
+            uniqueOrientations.insert(transformed);
+        }
+    }
+    return std::vector<std::vector<std::pair<int,int>>>(uniqueOrientations.begin(), uniqueOrientations.end());
+}
+
+// Precompute all legal placements for every piece in all orientations of all its forms.
+// Forms share one placement list per piece, so the solver never branches on the form.
+// Placements touching a blocked cell are never generated, so dead cells cost nothing later.
+void precomputeAllPiecePlacements(PuzzleTables &puzzle) {
+    const int totalCells = puzzle.totalCells;
+    puzzle.piecePlacementCells.assign(puzzle.totalPieces, {});
+    puzzle.piecePlacementsByCell.assign(puzzle.totalPieces, std::vector<std::vector<int>>(totalCells));
+    std::vector<bool> isBlockedCell(totalCells, false);
+    for (int cell : puzzle.blockedCells) isBlockedCell[cell] = true;
+
+    for (int pieceIdx = 0; pieceIdx < puzzle.totalPieces; ++pieceIdx) {
+        std::set<std::vector<std::pair<int,int>>> allOrientations;
+        for (const auto &form : splitPieceForms(puzzle.basePieceShapes[pieceIdx])) {
+            auto formOrientations = generateUniqueOrientations(parsePieceShape(form));
+            allOrientations.insert(formOrientations.begin(), formOrientations.end());
+        }
+
+        for (const auto &shape : allOrientations) {
+            int maxX = 0, maxY = 0;
+            for (const auto &coord : shape) {
+                maxX = std::max(maxX, coord.first);
+                maxY = std::max(maxY, coord.second);
+            }
+            int shapeWidth = maxX + 1;
+            int shapeHeight = maxY + 1;
+
+            for (int yOffset = 0; yOffset <= puzzle.boardHeight - shapeHeight; ++yOffset) {
+                for (int xOffset = 0; xOffset <= puzzle.boardWidth - shapeWidth; ++xOffset) {
+                    std::vector<int> cellIndices;
+                    bool validPlacement = true;
+                    for (const auto &coord : shape) {
+                        int x = xOffset + coord.first;
+                        int y = yOffset + coord.second;
+                        int cellIdx = y * puzzle.boardWidth + x;
+                        if (cellIdx < 0 || cellIdx >= totalCells || isBlockedCell[cellIdx]) {
+                            validPlacement = false;
+                            break;
+                        }
+                        cellIndices.push_back(cellIdx);
+                    }
+                    if (!validPlacement) continue;
+                    int placementIdx = puzzle.piecePlacementCells[pieceIdx].size();
+                    puzzle.piecePlacementCells[pieceIdx].push_back(cellIndices);
+                    for (int cell : cellIndices) {
+                        puzzle.piecePlacementsByCell[pieceIdx][cell].push_back(placementIdx);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Forms of one piece may differ in size, so the area the pieces cover is a range
+std::string describePieceAreaMismatch(const PuzzleTables &puzzle) {
+    int minPieceArea = 0, maxPieceArea = 0;
+    for (int pieceIdx = 0; pieceIdx < puzzle.totalPieces; ++pieceIdx) {
+        int smallestForm = INT32_MAX, largestForm = 0;
+        for (const auto &form : splitPieceForms(puzzle.basePieceShapes[pieceIdx])) {
+            int formArea = parsePieceShape(form).size();
+            smallestForm = std::min(smallestForm, formArea);
+            largestForm = std::max(largestForm, formArea);
+        }
+        minPieceArea += smallestForm;
+        maxPieceArea += largestForm;
+    }
+    int openCells = puzzle.totalCells - (int)puzzle.blockedCells.size();
+    if (openCells >= minPieceArea && openCells <= maxPieceArea) return "";
+    std::ostringstream message;
+    message << "pieces cover " << minPieceArea;
+    if (maxPieceArea != minPieceArea) message << "-" << maxPieceArea;
+    message << " cells but the board has " << openCells << " open cells";
+    return message.str();
+}
+
+void applyPieceOrdering(const PuzzleTables &puzzle, PieceOrdering ordering, SearchOptions &options) {
+    std::vector<int> order(puzzle.totalPieces);
+    for (int pieceIdx = 0; pieceIdx < puzzle.totalPieces; ++pieceIdx) order[pieceIdx] = pieceIdx;
+    if (ordering == ORDER_INDEX) {
+        options.setPieceOrder(std::vector<int>());
+        return;
+    }
+    // Largest form of each piece (multi-form pieces may have smaller ones too)
+    std::vector<size_t> pieceArea(puzzle.totalPieces, 0);
+    for (int pieceIdx = 0; pieceIdx < puzzle.totalPieces; ++pieceIdx) {
+        for (const auto &cells : puzzle.piecePlacementCells[pieceIdx]) pieceArea[pieceIdx] = std::max(pieceArea[pieceIdx], cells.size());
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        if (ordering == ORDER_LARGEST_FIRST) return pieceArea[a] > pieceArea[b];
+        return puzzle.piecePlacementCells[a].size() < puzzle.piecePlacementCells[b].size();
+    });
+    options.setPieceOrder(order);
+}
+
+// Text form of a search state: "<unit> <depth> <cell>:<piece>:<pos> ..."
+std::string serializeSearchState(const SearchState &state) {
+    std::ostringstream text;
+    text << state.unit << " " << state.frames.size();
+    for (const auto &frame : state.frames) {
+        text << " " << frame.cell << ":" << frame.pieceIdx << ":" << frame.candidatePos;
+    }
+    return text.str();
+}
+
+bool parseSearchState(const std::string &text, SearchState &state) {
+    std::istringstream fields(text);
+    size_t depth = 0;
+    SearchState parsed;
+    if (!(fields >> parsed.unit >> depth) || depth >= (size_t)MAX_PIECES) return false;
+    for (size_t d = 0; d < depth; ++d) {
+        SearchFrame frame;
+        char sep1 = 0, sep2 = 0;
+        if (!(fields >> frame.cell >> sep1 >> frame.pieceIdx >> sep2 >> frame.candidatePos) || sep1 != ':' || sep2 != ':') {
+            return false;
+        }
+        parsed.frames.push_back(frame);
+    }
+    state = parsed;
+    return true;
+}
+
+// 64-bit FNV-1a hash, used for board digests and puzzle fingerprints
+uint64_t fnv1aHash(const char *data, size_t length, uint64_t hash) {
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Order-independent digest of a set of boards: the sum of one hash per board, so the
+// result does not depend on how the work was split across ranks, threads or restarts
+uint64_t digestSolutions(const PuzzleTables &puzzle, const char *boards, size_t boardCount) {
+    uint64_t digest = 0;
+    for (size_t s = 0; s < boardCount; ++s) {
+        digest += fnv1aHash(boards + s * puzzle.totalCells, puzzle.totalCells);
+    }
+    return digest;
+}
+
+// Identifies the loaded puzzle so a checkpoint is never resumed against another one
+uint64_t puzzleFingerprint(const PuzzleTables &puzzle) {
+    std::ostringstream definition;
+    definition << puzzle.boardWidth << "x" << puzzle.boardHeight;
+    for (int cell : puzzle.blockedCells) definition << " " << cell;
+    for (const auto &shape : puzzle.basePieceShapes) definition << "|" << shape;
+    std::string text = definition.str();
+    return fnv1aHash(text.data(), text.size());
+}
+
+// Append boards to solutions.txt: one line per board row, a blank line after each board
+void formatBoardsAsText(const PuzzleTables &puzzle, const char *boards, size_t boardCount, char *text) {
+    const int width = puzzle.boardWidth, height = puzzle.boardHeight;
+    for (size_t s = 0; s < boardCount; ++s) {
+        const char *boardData = boards + s * puzzle.totalCells;
+        for (int row = 0; row < height; ++row) {
+            std::memcpy(text, boardData + row * width, width);
+            text[width] = '\n';
+            text += width + 1;
+        }
+        *text++ = '\n';
+    }
+}
+
+void writeBoardsAsText(std::ofstream &outputFile, const PuzzleTables &puzzle, const char *boards, size_t boardCount) {
+    const size_t boardBytes = boardTextBytes(puzzle);
+    const size_t batchBoards = std::max<size_t>(1, (4u << 20) / boardBytes);
+    std::vector<char> text(std::min(boardCount, batchBoards) * boardBytes);
+    for (size_t first = 0; first < boardCount; first += batchBoards) {
+        size_t count = std::min(batchBoards, boardCount - first);
+        formatBoardsAsText(puzzle, boards + first * puzzle.totalCells, count, text.data());
+        outputFile.write(text.data(), count * boardBytes);
+    }
+}
+
+bool readBoardsAsText(std::istream &input, const PuzzleTables &puzzle, std::vector<char> &boards, std::string &error) {
+    std::string line;
+    int row = 0;
+    long long lineNumber = 0;
+    while (std::getline(input, line)) {
+        ++lineNumber;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) {
+            if (row == 0) continue;
+            break;
+        }
+        if ((int)line.size() != puzzle.boardWidth) {
+            error = "line " + std::to_string(lineNumber) + " is not a board row of width " + std::to_string(puzzle.boardWidth);
+            return false;
+        }
+        boards.insert(boards.end(), line.begin(), line.end());
+        row = (row + 1) % puzzle.boardHeight;
+    }
+    if (row != 0) {
+        error = "the last board has only " + std::to_string(row) + " of " + std::to_string(puzzle.boardHeight) + " rows";
+        return false;
+    }
+    return true;
+}
+
+bool parseBoardsText(const char *text, size_t size, const PuzzleTables &puzzle, std::vector<char> &boards, std::string &error) {
+    const size_t width = puzzle.boardWidth;
+    size_t pos = 0;
+    int row = 0;
+    while (pos < size) {
+        const char *newline = static_cast<const char *>(std::memchr(text + pos, '\n', size - pos));
+        size_t lineEnd = newline ? newline - text : size;
+        size_t length = lineEnd - pos;
+        if (length > 0 && text[lineEnd - 1] == '\r') --length;
+        if (length == 0) {
+            if (row != 0) break;
+        } else if (length != width) {
+            error = "line of " + std::to_string(length) + " characters is not a board row of width " + std::to_string(width);
+            return false;
+        } else {
+            boards.insert(boards.end(), text + pos, text + pos + width);
+            row = (row + 1) % puzzle.boardHeight;
+        }
+        pos = lineEnd + 1;
+    }
+    if (row != 0) {
+        error = "the last board has only " + std::to_string(row) + " of " + std::to_string(puzzle.boardHeight) + " rows";
+        return false;
+    }
+    return true;
+}
+
+void printSolutionTotals(unsigned long long totalSolutions, unsigned long long digest) {
+    char digestText[17];
+    std::snprintf(digestText, sizeof(digestText), "%016llx", digest);
+    std::cout << "Total solutions: " << totalSolutions << "\n";
+    std::cout << "Solution digest: " << digestText << "\n";
+}
+
+double wallClockSeconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double percentileOf(std::vector<double> &samples, double fraction) {
+    if (samples.empty()) return 0.0;
+    size_t rank = std::min(samples.size() - 1, (size_t)(fraction * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+    return samples[rank];
+}
@@ -0,0 +1,450 @@
+// iqfit_core.h
+// Puzzle definition, placement tables and the resumable depth-first search shared by the
+// MPI solver (iqfit_mpi.cpp) and the standalone threaded solver (iqfit_threads.cpp).
+// Nothing in this module depends on MPI.
+
+#ifndef IQFIT_CORE_H
+#define IQFIT_CORE_H
+
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <array>
+#include <cstdint>
+#include <csignal>
+#include <iosfwd>
+
+// Hard limits for puzzles loaded from a definition file
+constexpr int MAX_BOARD_CELLS = 256;
+constexpr int MAX_PIECES = 26;   // pieces are labelled 'A'..'Z' on the output board
+
+// Boards with more than 64 cells are packed into several 64-bit words
+template <int Words>
+struct MultiWordMask {
+    std::array<uint64_t, Words> words;
+
+    MultiWordMask operator|(const MultiWordMask &other) const {
+        MultiWordMask result;
+        for (int w = 0; w < Words; ++w) result.words[w] = words[w] | other.words[w];
+        return result;
+    }
+
+    MultiWordMask operator&(const MultiWordMask &other) const {
+        MultiWordMask result;
+        for (int w = 0; w < Words; ++w) result.words[w] = words[w] & other.words[w];
+        return result;
+    }
+
+    MultiWordMask operator~() const {
+        MultiWordMask result;
+        for (int w = 0; w < Words; ++w) result.words[w] = ~words[w];
+        return result;
+    }
+};
+
+// The standard 11x5 IQ-Fit piece set, in "xy" format
+std::vector<std::string> standardPieceShapes();
+
+// One puzzle: its definition and the placement tables derived from it. The tables are
+// filled once by precomputeAllPiecePlacements and only read afterwards, so a single
+// instance can be shared by any number of concurrent searches.
+struct PuzzleTables {
+    // Board and puzzle parameters (the defaults describe the standard 11x5 IQ-Fit set)
+    int boardWidth = 11;
+    int boardHeight = 5;
+    int totalCells = 55;
+    int totalPieces = 12;
+
+    // Each shape string defines a base piece using "xy" format; pieces with several usable
+    // faces list each alternative footprint separated by '|' (e.g. "00 01 02 | 00 10 11")
+    std::vector<std::string> basePieceShapes = standardPieceShapes();
+
+    // Cells that are not part of the play area (listed by the puzzle definition)
+    std::vector<int> blockedCells;
+
+    // List of board cell indices covered by each valid placement
+    std::vector<std::vector<std::vector<int>>> piecePlacementCells;
+    // For each piece and board cell: which placements cover that cell
+    std::vector<std::vector<std::vector<int>>> piecePlacementsByCell;
+};
+
+// Representation of the board as a 1D character array ('.' = empty, '#' = blocked)
+using BoardRepresentation = std::vector<char>;
+
+// Mask primitives shared by the 64-bit fast path and the multi-word masks
+inline void occupyCell(uint64_t &mask, int cellIdx) { mask |= (1ULL << cellIdx); }
+inline bool masksOverlap(uint64_t a, uint64_t b) { return (a & b) != 0ULL; }
+
+template <int Words>
+inline void occupyCell(MultiWordMask<Words> &mask, int cellIdx) {
+    mask.words[cellIdx >> 6] |= (1ULL << (cellIdx & 63));
+}
+
+template <int Words>
+inline bool masksOverlap(const MultiWordMask<Words> &a, const MultiWordMask<Words> &b) {
+    uint64_t overlap = 0ULL;
+    for (int w = 0; w < Words; ++w) overlap |= a.words[w] & b.words[w];
+    return overlap != 0ULL;
+}
+
+// Index of the lowest clear bit, or totalCells when every board cell is occupied
+inline int findFirstEmptyCell(uint64_t mask, int totalCells) {
+    uint64_t emptyCells = ~mask;
+    if (emptyCells == 0ULL) return totalCells;
+    return std::min(__builtin_ctzll(emptyCells), totalCells);
+}
+
+template <int Words>
+inline int findFirstEmptyCell(const MultiWordMask<Words> &mask, int totalCells) {
+    for (int w = 0; w < Words; ++w) {
+        uint64_t emptyCells = ~mask.words[w];
+        if (emptyCells != 0ULL) return std::min(w * 64 + __builtin_ctzll(emptyCells), totalCells);
+    }
+    return totalCells;
+}
+
+// Parse a piece shape string into a list of coordinate pairs
+std::vector<std::pair<int,int>> parsePieceShape(const std::string &shapeStr);
+
+// Split a piece definition into its alternative footprints (forms)
+std::vector<std::string> splitPieceForms(const std::string &shapeStr);
+
+// Read board size, blocked cells and piece shapes from a puzzle definition (format
+// described in iqfit_core.cpp and the README); path only labels error messages
+bool parsePuzzleDefinition(std::istream &input, const std::string &path, PuzzleTables &puzzle, std::string &error);
+
+// Load a puzzle definition file
+bool loadPuzzleDefinition(const std::string &path, PuzzleTables &puzzle, std::string &error);
+
+// Precompute all legal placements for every piece in all orientations of all its forms
+void precomputeAllPiecePlacements(PuzzleTables &puzzle);
+
+// Describe a mismatch between the area the pieces can cover and the open cells (empty if none)
+std::string describePieceAreaMismatch(const PuzzleTables &puzzle);
+
+// Build the bitmask of every placement for the mask width chosen at run time
+template <typename BoardMask>
+std::vector<std::vector<BoardMask>> buildPlacementMasks(const PuzzleTables &puzzle) {
+    std::vector<std::vector<BoardMask>> placementMasks(puzzle.totalPieces);
+    for (int pieceIdx = 0; pieceIdx < puzzle.totalPieces; ++pieceIdx) {
+        for (const auto &cellIndices : puzzle.piecePlacementCells[pieceIdx]) {
+            BoardMask placementMask{};
+            for (int cell : cellIndices) occupyCell(placementMask, cell);
+            placementMasks[pieceIdx].push_back(placementMask);
+        }
+    }
+    return placementMasks;
+}
+
+// One level of the explicit search stack: the cell being covered and the candidate
+// chosen for it (a piece and a position in that piece's placement list for the cell)
+struct SearchFrame {
+    int cell;
+    int pieceIdx;
+    int candidatePos;
+};
+
+// Exact position inside one work unit: the placements stacked on top of the unit's
+// first-piece placement. Searching resumes by expanding the node these frames reach.
+// A state with unit -1 searches from the starting position alone (used for boards
+// that already hold some pieces).
+struct SearchState {
+    int unit = -1;
+    std::vector<SearchFrame> frames;
+};
+
+enum SearchStatus { SEARCH_FINISHED, SEARCH_PAUSED, SEARCH_INVALID_STATE };
+
+// Set from a signal handler to stop the search at the next node and save its position
+extern volatile std::sig_atomic_t preemptRequested;
+
+// Text form of a search state: "<unit> <depth> <cell>:<piece>:<pos> ..."
+std::string serializeSearchState(const SearchState &state);
+bool parseSearchState(const std::string &text, SearchState &state);
+
+// Position a search starts from: blocked cells plus any pieces already on the board
+template <typename BoardMask>
+struct SearchStart {
+    BoardMask mask{};
+    BoardRepresentation board;
+    std::array<bool, MAX_PIECES> usedPieces;
+};
+
+// Empty board with only the blocked cells filled in
+template <typename BoardMask>
+SearchStart<BoardMask> emptyBoardStart(const PuzzleTables &puzzle) {
+    SearchStart<BoardMask> start;
+    start.board.assign(puzzle.totalCells, '.');
+    start.usedPieces.fill(false);
+    for (int cell : puzzle.blockedCells) {
+        occupyCell(start.mask, cell);
+        start.board[cell] = '#';
+    }
+    return start;
+}
+
+// Optional search behaviour; the defaults give the plain first-empty-cell search. A saved
+// SearchState only resumes under the options it was produced with.
+struct SearchOptions {
+    // Constraint propagation before each branch: cut positions where an empty cell can no
+    // longer be covered or a remaining piece no longer fits, and branch on a forced move
+    // (a cell with a single candidate, or a piece with a single placement left) when there
+    // is one. Costs one pass over the remaining placements per node, so it pays off on
+    // boards that already hold several pieces rather than on the empty board.
+    bool propagate = false;
+
+    // Order in which pieces are tried at each cell (empty = index order); see setPieceOrder
+    std::vector<int> pieceOrder;
+    std::vector<int> pieceRank;     // position of each piece in pieceOrder
+
+    // Placements of each piece at each cell in the order they are tried (empty = generation
+    // order); same shape as PuzzleTables::piecePlacementsByCell, each list a permutation
+    std::vector<std::vector<std::vector<int>>> candidateOrder;
+
+    void setPieceOrder(const std::vector<int> &order) {
+        pieceOrder = order;
+        pieceRank.assign(order.size(), 0);
+        for (size_t rank = 0; rank < order.size(); ++rank) pieceRank[order[rank]] = rank;
+    }
+
+    int firstPiece() const { return pieceOrder.empty() ? 0 : pieceOrder[0]; }
+};
+
+// Built-in piece orderings (ORDER_LEARNED comes from learnSearchOrdering in the library)
+enum PieceOrdering { ORDER_INDEX, ORDER_LARGEST_FIRST, ORDER_FEWEST_PLACEMENTS };
+
+// Set options.pieceOrder for one of the built-in orderings (ties keep index order)
+void applyPieceOrdering(const PuzzleTables &puzzle, PieceOrdering ordering, SearchOptions &options);
+
+// Candidate placements of a piece at a cell, in the order the search tries them
+inline const std::vector<int> &candidatesAt(const PuzzleTables &puzzle, const SearchOptions &options, int pieceIdx, int cell) {
+    return options.candidateOrder.empty() ? puzzle.piecePlacementsByCell[pieceIdx][cell] : options.candidateOrder[pieceIdx][cell];
+}
+
+// Cell a node branches on: the first empty cell, or with propagation the cell of a forced
+// move if there is one. Returns totalCells when the board is full and -1 when propagation
+// proves the position has no completion.
+template <typename BoardMask>
+int chooseBranchCell(
+    const PuzzleTables &puzzle,
+    const std::vector<std::vector<BoardMask>> &piecePlacementMasks,
+    const BoardMask &boardMask,
+    const std::array<bool, MAX_PIECES> &usedPieces,
+    const SearchOptions &options
+) {
+    int firstEmptyCell = findFirstEmptyCell(boardMask, puzzle.totalCells);
+    if (!options.propagate || firstEmptyCell >= puzzle.totalCells) return firstEmptyCell;
+
+    // Cells covered by at least one and by at least two of the placements that still fit
+    BoardMask coveredOnce{}, coveredTwice{};
+    int forcedPieceCell = -1;
+    for (int pieceIdx = 0; pieceIdx < puzzle.totalPieces; ++pieceIdx) {
+        if (usedPieces[pieceIdx]) continue;
+        int fitting = 0, lastFit = -1;
+        const std::vector<BoardMask> &placements = piecePlacementMasks[pieceIdx];
+        for (int placementIdx = 0; placementIdx < (int)placements.size(); ++placementIdx) {
+            if (masksOverlap(placements[placementIdx], boardMask)) continue;
+            coveredTwice = coveredTwice | (coveredOnce & placements[placementIdx]);
+            coveredOnce = coveredOnce | placements[placementIdx];
+            ++fitting;
+            lastFit = placementIdx;
+        }
+        if (fitting == 0) return -1;
+        if (fitting == 1 && forcedPieceCell < 0) {
+            const std::vector<int> &cells = puzzle.piecePlacementCells[pieceIdx][lastFit];
+            forcedPieceCell = *std::min_element(cells.begin(), cells.end());
+        }
+    }
+
+    // An empty cell nothing can cover: dead end
+    if (findFirstEmptyCell(boardMask | coveredOnce, puzzle.totalCells) < puzzle.totalCells) return -1;
+    // An empty cell exactly one placement covers: that placement is forced
+    int singleCandidateCell = findFirstEmptyCell(boardMask | coveredTwice | ~coveredOnce, puzzle.totalCells);
+    if (singleCandidateCell < puzzle.totalCells) return singleCandidateCell;
+    // A piece with one placement left: branch on one of its cells, where every other
+    // candidate overlaps that placement and is cut one level down
+    if (forcedPieceCell >= 0) return forcedPieceCell;
+    return firstEmptyCell;
+}
+
+// Move a frame to its next legal candidate (unused piece, no collision), trying pieces in
+// the options' piece order and each piece's candidates in its candidate order (index and
+// generation order by default); false when none is left
+template <typename BoardMask>
+inline bool advanceFrame(
+    const PuzzleTables &puzzle,
+    const std::vector<std::vector<BoardMask>> &piecePlacementMasks,
+    const BoardMask &boardMask,
+    const std::array<bool, MAX_PIECES> &usedPieces,
+    const SearchOptions &options,
+    SearchFrame &frame
+) {
+    bool ordered = !options.pieceOrder.empty();
+    int startPos = frame.candidatePos + 1;
+    for (int rank = ordered ? options.pieceRank[frame.pieceIdx] : frame.pieceIdx; rank < puzzle.totalPieces; ++rank, startPos = 0) {
+        int pieceIdx = ordered ? options.pieceOrder[rank] : rank;
+        if (usedPieces[pieceIdx]) continue;
+        const std::vector<int> &candidates = candidatesAt(puzzle, options, pieceIdx, frame.cell);
+        for (int pos = startPos; pos < (int)candidates.size(); ++pos) {
+            if (masksOverlap(piecePlacementMasks[pieceIdx][candidates[pos]], boardMask)) continue;
+            frame.pieceIdx = pieceIdx;
+            frame.candidatePos = pos;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Backtracking search over one work unit, driven by an explicit stack so that it can stop
+// at any node and later continue from the saved SearchState. Each solution is handed to
+// onSolution (called with the row-major board, totalCells characters) as soon as it is
+// found; returning false stops the search right after that solution. Each call expands at
+// most nodeBudget nodes (or stops early on a preemption request or a visitor stop) and
+// returns SEARCH_PAUSED with the state pointing at the next node to expand, so a later call
+// continues with the next solution; SEARCH_FINISHED once the unit is exhausted. The same
+// options must be passed to every call that continues a state.
+// Only reads the puzzle tables, so concurrent searches may share them.
+template <typename BoardMask, typename SolutionVisitor>
+SearchStatus resumeSearch(
+    const PuzzleTables &puzzle,
+    const std::vector<std::vector<BoardMask>> &piecePlacementMasks,
+    const SearchStart<BoardMask> &start,
+    SearchState &state,
+    long long nodeBudget,
+    SolutionVisitor &&onSolution,
+    const SearchOptions &options = SearchOptions()
+) {
+    const int totalCells = puzzle.totalCells;
+    std::array<BoardMask, MAX_PIECES + 1> maskAtDepth;
+    std::array<bool, MAX_PIECES> usedPieces = start.usedPieces;
+    BoardRepresentation currentBoard = start.board;
+
+    // Put a frame's candidate on the board above depth d
+    auto placeFrame = [&](const SearchFrame &frame, int d) {
+        int placementIdx = candidatesAt(puzzle, options, frame.pieceIdx, frame.cell)[frame.candidatePos];
+        usedPieces[frame.pieceIdx] = true;
+        maskAtDepth[d + 1] = maskAtDepth[d] | piecePlacementMasks[frame.pieceIdx][placementIdx];
+        for (int cell : puzzle.piecePlacementCells[frame.pieceIdx][placementIdx]) currentBoard[cell] = char('A' + frame.pieceIdx);
+    };
+
+    // Rebuild masks, used pieces and board from the unit and the saved frames
+    maskAtDepth[0] = start.mask;
+    if (state.unit >= 0) {
+        if (usedPieces[0] || state.unit >= (int)piecePlacementMasks[0].size() ||
+            masksOverlap(piecePlacementMasks[0][state.unit], start.mask)) {
+            return SEARCH_INVALID_STATE;
+        }
+        maskAtDepth[0] = start.mask | piecePlacementMasks[0][state.unit];
+        usedPieces[0] = true;
+        for (int cell : puzzle.piecePlacementCells[0][state.unit]) currentBoard[cell] = 'A';
+    }
+    // Pieces on the board below the first frame
+    int basePieces = std::count(usedPieces.begin(), usedPieces.begin() + puzzle.totalPieces, true);
+
+    std::vector<SearchFrame> &frames = state.frames;
+    for (size_t d = 0; d < frames.size(); ++d) {
+        const SearchFrame &frame = frames[d];
+        if (frame.cell < 0 || frame.cell >= totalCells ||
+            frame.cell != chooseBranchCell(puzzle, piecePlacementMasks, maskAtDepth[d], usedPieces, options) || frame.pieceIdx < 0 ||
+            frame.pieceIdx >= puzzle.totalPieces || usedPieces[frame.pieceIdx] || frame.candidatePos < 0 ||
+            frame.candidatePos >= (int)candidatesAt(puzzle, options, frame.pieceIdx, frame.cell).size()) {
+            return SEARCH_INVALID_STATE;
+        }
+        int placementIdx = candidatesAt(puzzle, options, frame.pieceIdx, frame.cell)[frame.candidatePos];
+        if (masksOverlap(piecePlacementMasks[frame.pieceIdx][placementIdx], maskAtDepth[d])) return SEARCH_INVALID_STATE;
+        placeFrame(frame, d);
+    }
+
+    int depth = frames.size();
+    bool expandNode = true;
+    bool stopRequested = false;
+    while (true) {
+        if (expandNode) {
+            if (nodeBudget-- <= 0 || preemptRequested || stopRequested) return SEARCH_PAUSED;
+
+            // Find the cell to cover (the first empty cell unless propagation picks a forced move)
+            int branchCell = chooseBranchCell(puzzle, piecePlacementMasks, maskAtDepth[depth], usedPieces, options);
+
+            // Base case: board full with all pieces placed (with multi-form pieces the board
+            // can fill up before every piece is used, or the pieces can run out first)
+            if (branchCell >= totalCells) {
+                if (basePieces + depth == puzzle.totalPieces && !onSolution(currentBoard.data())) {
+                    stopRequested = true;
+                }
+            } else if (branchCell >= 0) {
+                // Try all unused pieces that can cover the current cell
+                SearchFrame frame = { branchCell, options.firstPiece(), -1 };
+                if (advanceFrame(puzzle, piecePlacementMasks, maskAtDepth[depth], usedPieces, options, frame)) {
+                    placeFrame(frame, depth);
+                    frames.push_back(frame);
+                    ++depth;
+                    continue;
+                }
+            }
+        }
+
+        // Backtrack: lift the top piece and move its frame to the next candidate
+        if (depth == 0) return SEARCH_FINISHED;
+        --depth;
+        SearchFrame &frame = frames[depth];
+        int placementIdx = candidatesAt(puzzle, options, frame.pieceIdx, frame.cell)[frame.candidatePos];
+        usedPieces[frame.pieceIdx] = false;
+        for (int cell : puzzle.piecePlacementCells[frame.pieceIdx][placementIdx]) currentBoard[cell] = '.';
+
+        expandNode = advanceFrame(puzzle, piecePlacementMasks, maskAtDepth[depth], usedPieces, options, frame);
+        if (expandNode) {
+            placeFrame(frame, depth);
+            ++depth;
+        } else {
+            frames.pop_back();
+        }
+    }
+}
+
+// Visitor that appends every solution to a flat buffer of boards
+struct AppendSolutions {
+    std::vector<char> &boards;
+    int totalCells;
+
+    bool operator()(const char *board) const {
+        boards.insert(boards.end(), board, board + totalCells);
+        return true;
+    }
+};
+
+// 64-bit FNV-1a hash, used for board digests and puzzle fingerprints
+uint64_t fnv1aHash(const char *data, size_t length, uint64_t hash = 14695981039346656037ULL);
+
+// Order-independent digest of a set of boards: the sum of one hash per board, so the
+// result does not depend on how the work was split across ranks, threads or restarts
+uint64_t digestSolutions(const PuzzleTables &puzzle, const char *boards, size_t boardCount);
+
+// Identifies the loaded puzzle so checkpoints and workers never mix two puzzles
+uint64_t puzzleFingerprint(const PuzzleTables &puzzle);
+
+// Bytes of one board in solutions.txt: every row plus its newline, then a blank line
+inline size_t boardTextBytes(const PuzzleTables &puzzle) { return size_t(puzzle.boardHeight) * (puzzle.boardWidth + 1) + 1; }
+
+// Render boards in the solutions.txt layout into text (boardCount * boardTextBytes bytes)
+void formatBoardsAsText(const PuzzleTables &puzzle, const char *boards, size_t boardCount, char *text);
+
+// Append boards to solutions.txt: one line per board row, a blank line after each board.
+// Boards are formatted in batches of a few MB and each batch is one write.
+void writeBoardsAsText(std::ofstream &outputFile, const PuzzleTables &puzzle, const char *boards, size_t boardCount);
+
+// Read boards in the same layout (blank lines between boards are optional) and append them to
+// boards; fails on a row of the wrong width or a board cut short
+bool readBoardsAsText(std::istream &input, const PuzzleTables &puzzle, std::vector<char> &boards, std::string &error);
+
+// Same, for text already in memory (for example a chunk cut at a blank line)
+bool parseBoardsText(const char *text, size_t size, const PuzzleTables &puzzle, std::vector<char> &boards, std::string &error);
+
+void printSolutionTotals(unsigned long long totalSolutions, unsigned long long digest);
+
+// Monotonic wall-clock time in seconds (MPI_Wtime is not available without MPI)
+double wallClockSeconds();
+
+// Value below which the given fraction of the samples falls (nearest rank); reorders samples
+double percentileOf(std::vector<double> &samples, double fraction);
+
+#endif // IQFIT_CORE_H
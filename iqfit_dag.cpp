@@ -0,0 +1,326 @@
+// iqfit_dag.cpp
+// Memoized construction of the solution DAG, its queries and its file format.
+
+#include "iqfit_dag.h"
+
+#include <fstream>
+#include <cstring>
+#include <unordered_map>
+
+constexpr uint32_t SolutionDag::NO_NODE;
+constexpr uint32_t SolutionDag::TERMINAL_NODE;
+constexpr uint32_t DAG_VERSION = 1;
+
+static uint64_t mixBits(uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    return value;
+}
+
+static uint64_t hashMask(uint64_t mask) { return mask; }
+
+template <int Words>
+static uint64_t hashMask(const MultiWordMask<Words> &mask) {
+    uint64_t hash = 0;
+    for (uint64_t word : mask.words) hash = mixBits(hash ^ word) + 0x9e3779b97f4a7c15ULL;
+    return hash;
+}
+
+// Search states by (covered cells, used pieces); dead states map to NO_NODE
+template <typename BoardMask>
+class SolutionDagBuilder {
+public:
+    SolutionDagBuilder(const PuzzleTables &puzzle, SolutionDag &dag, size_t nodeLimit)
+        : puzzle(puzzle), dag(dag), piecePlacementMasks(buildPlacementMasks<BoardMask>(puzzle)), nodeLimit(nodeLimit) {}
+
+    uint32_t build(const BoardMask &mask, uint32_t usedPieces) {
+        int cell = findFirstEmptyCell(mask, puzzle.totalCells);
+        if (cell >= puzzle.totalCells) {
+            return usedPieces == allPieces() ? SolutionDag::TERMINAL_NODE : SolutionDag::NO_NODE;
+        }
+        StateKey key = { mask, usedPieces };
+        auto found = memo.find(key);
+        if (found != memo.end()) return found->second;
+        if (memo.size() >= nodeLimit) {
+            limitExceeded = true;
+            return SolutionDag::NO_NODE;
+        }
+
+        std::vector<SolutionDagEdge> nodeEdges;
+        for (int p = 0; p < puzzle.totalPieces && !limitExceeded; ++p) {
+            uint32_t pieceBit = 1u << p;
+            if (usedPieces & pieceBit) continue;
+            for (int placementIdx : puzzle.piecePlacementsByCell[p][cell]) {
+                const BoardMask &placement = piecePlacementMasks[p][placementIdx];
+                if (masksOverlap(placement, mask)) continue;
+                uint32_t child = build(mask | placement, usedPieces | pieceBit);
+                if (child != SolutionDag::NO_NODE) nodeEdges.push_back(SolutionDagEdge{ uint32_t(p), uint32_t(placementIdx), child });
+            }
+        }
+        uint32_t node = nodeEdges.empty() || limitExceeded ? SolutionDag::NO_NODE : dag.addNode(nodeEdges);
+        memo.emplace(key, node);
+        return node;
+    }
+
+    bool limitExceeded = false;
+
+private:
+    struct StateKey {
+        BoardMask mask;
+        uint32_t pieces;
+    };
+    struct StateHash {
+        size_t operator()(const StateKey &key) const { return mixBits(hashMask(key.mask) ^ (uint64_t(key.pieces) << 40)); }
+    };
+    struct StateEqual {
+        bool operator()(const StateKey &a, const StateKey &b) const {
+            return a.pieces == b.pieces && std::memcmp(&a.mask, &b.mask, sizeof(BoardMask)) == 0;
+        }
+    };
+
+    uint32_t allPieces() const { return puzzle.totalPieces == 32 ? 0xFFFFFFFFu : (1u << puzzle.totalPieces) - 1; }
+
+    const PuzzleTables &puzzle;
+    SolutionDag &dag;
+    std::vector<std::vector<BoardMask>> piecePlacementMasks;
+    std::unordered_map<StateKey, uint32_t, StateHash, StateEqual> memo;
+    size_t nodeLimit;
+};
+
+SolutionDag::SolutionDag(const PuzzleTables &puzzle) : puzzle(puzzle) {}
+
+void SolutionDag::clear() {
+    firstEdge.assign(1, 0);
+    edges.clear();
+    completions.clear();
+    root = NO_NODE;
+}
+
+uint32_t SolutionDag::addNode(const std::vector<SolutionDagEdge> &nodeEdges) {
+    edges.insert(edges.end(), nodeEdges.begin(), nodeEdges.end());
+    firstEdge.push_back(edges.size());
+    return firstEdge.size() - 2;
+}
+
+// Children come before their parents, so one forward pass sums every node's completions
+void SolutionDag::countAllCompletions() {
+    completions.assign(nodeCount(), 0);
+    if (completions.empty()) return;
+    completions[TERMINAL_NODE] = 1;
+    for (size_t node = 1; node < completions.size(); ++node) {
+        for (uint32_t e = firstEdge[node]; e < firstEdge[node + 1]; ++e) completions[node] += completions[edges[e].child];
+    }
+}
+
+template <typename BoardMask>
+static bool buildDag(const PuzzleTables &puzzle, SolutionDag &dag, uint32_t &root, size_t nodeLimit, std::string &error) {
+    SolutionDagBuilder<BoardMask> builder(puzzle, dag, nodeLimit);
+    root = builder.build(emptyBoardStart<BoardMask>(puzzle).mask, 0);
+    if (builder.limitExceeded) {
+        error = "the DAG outgrew its limit of " + std::to_string(nodeLimit) + " states; raise the limit or use a smaller puzzle";
+        return false;
+    }
+    return true;
+}
+
+bool SolutionDag::build(size_t nodeLimit, std::string &error) {
+    clear();
+    addNode(std::vector<SolutionDagEdge>());   // terminal node: the full board
+    bool built;
+    switch ((puzzle.totalCells + 63) / 64) {
+        case 1: built = buildDag<uint64_t>(puzzle, *this, root, nodeLimit, error); break;
+        case 2: built = buildDag<MultiWordMask<2>>(puzzle, *this, root, nodeLimit, error); break;
+        case 3: built = buildDag<MultiWordMask<3>>(puzzle, *this, root, nodeLimit, error); break;
+        default: built = buildDag<MultiWordMask<4>>(puzzle, *this, root, nodeLimit, error); break;
+    }
+    if (!built) {
+        clear();
+        return false;
+    }
+    countAllCompletions();
+    return true;
+}
+
+BoardRepresentation SolutionDag::emptyBoard() const {
+    BoardRepresentation board(puzzle.totalCells, '.');
+    for (int cell : puzzle.blockedCells) board[cell] = '#';
+    return board;
+}
+
+bool SolutionDag::visitFrom(uint32_t node, BoardRepresentation &board, const std::function<bool(const char *)> &visit) const {
+    if (node == TERMINAL_NODE) return visit(board.data());
+    for (uint32_t e = firstEdge[node]; e < firstEdge[node + 1]; ++e) {
+        const SolutionDagEdge &edge = edges[e];
+        const std::vector<int> &cells = puzzle.piecePlacementCells[edge.piece][edge.placement];
+        for (int cell : cells) board[cell] = char('A' + edge.piece);
+        bool keepGoing = visitFrom(edge.child, board, visit);
+        for (int cell : cells) board[cell] = '.';
+        if (!keepGoing) return false;
+    }
+    return true;
+}
+
+void SolutionDag::forEachSolution(const std::function<bool(const char *)> &visit) const {
+    if (root == NO_NODE) return;
+    BoardRepresentation board = emptyBoard();
+    visitFrom(root, board, visit);
+}
+
+bool SolutionDag::contains(const char *board) const {
+    if (root == NO_NODE) return false;
+    std::vector<int> pieceSize(puzzle.totalPieces, 0);
+    for (int cell = 0; cell < puzzle.totalCells; ++cell) {
+        int p = board[cell] - 'A';
+        if (p >= 0 && p < puzzle.totalPieces) ++pieceSize[p];
+    }
+    BoardRepresentation filled = emptyBoard();
+    uint32_t node = root;
+    int cell = 0;
+    while (node != TERMINAL_NODE) {
+        while (filled[cell] != '.') ++cell;
+        int p = board[cell] - 'A';
+        uint32_t next = NO_NODE;
+        for (uint32_t e = firstEdge[node]; e < firstEdge[node + 1] && next == NO_NODE; ++e) {
+            if ((int)edges[e].piece != p) continue;
+            const std::vector<int> &cells = puzzle.piecePlacementCells[p][edges[e].placement];
+            bool matches = (int)cells.size() == pieceSize[p];
+            for (int covered : cells) matches = matches && board[covered] == board[cell];
+            if (matches) next = e;
+        }
+        if (next == NO_NODE) return false;
+        for (int covered : puzzle.piecePlacementCells[p][edges[next].placement]) filled[covered] = board[cell];
+        node = edges[next].child;
+    }
+    return true;
+}
+
+// A placement agrees with the partial board if it covers exactly the cells of its piece
+// there, or only empty cells when the piece is not on the board; the answer depends on the
+// node alone, so every node is counted once
+unsigned long long SolutionDag::countFrom(uint32_t node, const char *partialBoard, const std::vector<bool> &placed,
+                                          std::vector<unsigned long long> &memo) const {
+    if (node == TERMINAL_NODE) return 1;
+    if (memo[node] != ~0ULL) return memo[node];
+    unsigned long long count = 0;
+    for (uint32_t e = firstEdge[node]; e < firstEdge[node + 1]; ++e) {
+        const SolutionDagEdge &edge = edges[e];
+        char expected = placed[edge.piece] ? char('A' + edge.piece) : '.';
+        bool agrees = true;
+        for (int cell : puzzle.piecePlacementCells[edge.piece][edge.placement]) agrees = agrees && partialBoard[cell] == expected;
+        if (agrees) count += countFrom(edge.child, partialBoard, placed, memo);
+    }
+    return memo[node] = count;
+}
+
+bool SolutionDag::countCompletions(const char *partialBoard, unsigned long long &count, std::string &error) const {
+    std::vector<bool> placed(puzzle.totalPieces, false);
+    std::vector<bool> blocked(puzzle.totalCells, false);
+    for (int cell : puzzle.blockedCells) blocked[cell] = true;
+    bool empty = true;
+    for (int cell = 0; cell < puzzle.totalCells; ++cell) {
+        char c = partialBoard[cell];
+        int p = c - 'A';
+        if (blocked[cell] ? c != '#' : c != '.' && (p < 0 || p >= puzzle.totalPieces)) {
+            error = "unexpected '" + std::string(1, c) + "' at cell " + std::to_string(cell);
+            return false;
+        }
+        if (c != '.' && c != '#') {
+            placed[p] = true;
+            empty = false;
+        }
+    }
+    if (empty || root == NO_NODE) {
+        count = solutionCount();
+        return true;
+    }
+    std::vector<unsigned long long> memo(nodeCount(), ~0ULL);
+    count = countFrom(root, partialBoard, placed, memo);
+    return true;
+}
+
+static void writeU32(std::ostream &output, uint32_t value) {
+    char bytes[4] = { char(value), char(value >> 8), char(value >> 16), char(value >> 24) };
+    output.write(bytes, 4);
+}
+
+static bool readU32(std::istream &input, uint32_t &value) {
+    unsigned char bytes[4];
+    if (!input.read(reinterpret_cast<char *>(bytes), 4)) return false;
+    value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (uint32_t(bytes[3]) << 24);
+    return true;
+}
+
+bool SolutionDag::save(const std::string &path, std::string &error) const {
+    std::ofstream output(path, std::ios::binary);
+    if (!output) {
+        error = "cannot open " + path;
+        return false;
+    }
+    uint64_t fingerprint = puzzleFingerprint(puzzle);
+    output.write("IQFD", 4);
+    for (uint32_t value : { DAG_VERSION, uint32_t(fingerprint), uint32_t(fingerprint >> 32), uint32_t(puzzle.totalCells),
+                            uint32_t(puzzle.totalPieces), uint32_t(nodeCount()), uint32_t(edges.size()), root }) {
+        writeU32(output, value);
+    }
+    for (uint32_t offset : firstEdge) writeU32(output, offset);
+    for (const SolutionDagEdge &edge : edges) {
+        writeU32(output, edge.piece);
+        writeU32(output, edge.placement);
+        writeU32(output, edge.child);
+    }
+    if (!output.flush()) {
+        error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
+
+bool SolutionDag::load(const std::string &path, std::string &error) {
+    clear();
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        error = "cannot open " + path;
+        return false;
+    }
+    char magic[4];
+    uint32_t header[8];
+    bool readable = input.read(magic, 4) && std::string(magic, 4) == "IQFD";
+    for (uint32_t &value : header) readable = readable && readU32(input, value);
+    if (!readable || header[0] != DAG_VERSION) {
+        error = path + " is not a solution DAG file";
+        return false;
+    }
+    uint64_t fingerprint = header[1] | (uint64_t(header[2]) << 32);
+    if (fingerprint != puzzleFingerprint(puzzle) || (int)header[3] != puzzle.totalCells || (int)header[4] != puzzle.totalPieces) {
+        error = path + " was built for a different puzzle (use the same --puzzle)";
+        return false;
+    }
+    uint32_t nodes = header[5], edgeTotal = header[6];
+    root = header[7];
+    firstEdge.resize(size_t(nodes) + 1);
+    edges.resize(edgeTotal);
+    for (uint32_t &offset : firstEdge) readable = readable && readU32(input, offset);
+    for (SolutionDagEdge &edge : edges) {
+        readable = readable && readU32(input, edge.piece) && readU32(input, edge.placement) && readU32(input, edge.child);
+    }
+
+    // Post order, offsets in range and placements that exist, so queries never leave the arrays
+    bool consistent = readable && nodes > 0 && firstEdge[0] == 0 && firstEdge[1] == 0 && firstEdge[nodes] == edgeTotal &&
+                      (root == NO_NODE || root < nodes);
+    for (uint32_t node = 0; consistent && node < nodes; ++node) {
+        consistent = firstEdge[node] <= firstEdge[node + 1] && firstEdge[node + 1] <= edgeTotal;
+        for (uint32_t e = firstEdge[node]; consistent && e < firstEdge[node + 1]; ++e) {
+            const SolutionDagEdge &edge = edges[e];
+            consistent = edge.child < node && (int)edge.piece < puzzle.totalPieces &&
+                         edge.placement < puzzle.piecePlacementCells[edge.piece].size();
+        }
+    }
+    if (!consistent) {
+        clear();
+        error = path + " is truncated or corrupt";
+        return false;
+    }
+    countAllCompletions();
+    return true;
+}
@@ -0,0 +1,82 @@
+// iqfit_dag.h
+// The whole solution set as a DAG. The search from the empty board always covers the first
+// empty cell next, so everything below a search node depends only on its state: the mask of
+// covered cells and the set of pieces used. The builder memoizes on that state, so equal
+// suffix subtrees are stored once, and it drops every state without a completion. A path
+// from the root to the terminal node is one solution; its edges are (piece, placement) in
+// search order.
+//
+// Nodes are numbered in post order (children before parents), so the completion counts
+// come from one pass over the nodes. The same property makes save/load a flat array copy.
+//
+// File layout (integers little-endian):
+//   "IQFD", version u32, puzzle fingerprint u64, totalCells u32, totalPieces u32,
+//   nodeCount u32, edgeCount u32, root u32,
+//   firstEdge u32 x (nodeCount + 1), edges (piece u32, placement u32, child u32) x edgeCount
+
+#ifndef IQFIT_DAG_H
+#define IQFIT_DAG_H
+
+#include "iqfit_core.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct SolutionDagEdge {
+    uint32_t piece;
+    uint32_t placement;     // index into piecePlacementCells[piece]
+    uint32_t child;
+};
+
+class SolutionDag {
+public:
+    static constexpr uint32_t NO_NODE = 0xFFFFFFFFu;
+    static constexpr uint32_t TERMINAL_NODE = 0;
+
+    explicit SolutionDag(const PuzzleTables &puzzle);
+
+    // Build from the empty board; fails once more than nodeLimit states have been explored
+    // (dead ends included), leaving the DAG empty
+    bool build(size_t nodeLimit, std::string &error);
+
+    bool save(const std::string &path, std::string &error) const;
+    bool load(const std::string &path, std::string &error);
+
+    // Number of solutions
+    unsigned long long solutionCount() const { return root == NO_NODE ? 0 : completions[root]; }
+
+    // Solutions that agree with a partial board (totalCells characters, '.' for empty
+    // cells, pieces by letter); fails on a malformed board
+    bool countCompletions(const char *partialBoard, unsigned long long &count, std::string &error) const;
+
+    // Whether a complete board is one of the solutions
+    bool contains(const char *board) const;
+
+    // Visit every solution in search order until the visitor returns false
+    void forEachSolution(const std::function<bool(const char *)> &visit) const;
+
+    size_t nodeCount() const { return firstEdge.empty() ? 0 : firstEdge.size() - 1; }
+    size_t edgeCount() const { return edges.size(); }
+
+private:
+    template <typename BoardMask>
+    friend class SolutionDagBuilder;
+
+    uint32_t addNode(const std::vector<SolutionDagEdge> &nodeEdges);
+    void clear();
+    void countAllCompletions();
+    BoardRepresentation emptyBoard() const;
+    bool visitFrom(uint32_t node, BoardRepresentation &board, const std::function<bool(const char *)> &visit) const;
+    unsigned long long countFrom(uint32_t node, const char *partialBoard, const std::vector<bool> &placed,
+                                 std::vector<unsigned long long> &memo) const;
+
+    const PuzzleTables &puzzle;
+    std::vector<uint32_t> firstEdge;
+    std::vector<SolutionDagEdge> edges;
+    std::vector<unsigned long long> completions;
+    uint32_t root = NO_NODE;
+};
+
+#endif // IQFIT_DAG_H
@@ -0,0 +1,135 @@
+// iqfit_dag_tool.cpp
+// Command-line front end for the solution DAG (iqfit_dag.h): build it once and save it, then
+// count, list or look up solutions without searching again.
+//
+//   build <out.dag>              build from the empty board and save
+//   count <in.dag> [<boards>]    number of solutions, or completions of each partial board
+//   list <in.dag> [<out.txt>]    every solution in search order, as solutions.txt text
+//   contains <in.dag> <boards>   which of the boards are solutions
+//
+// Board files use the solutions.txt layout; '.' marks an empty cell of a partial board.
+
+#include "iqfit_core.h"
+#include "iqfit_dag.h"
+#include "iqfit_output.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+static bool loadBoards(const std::string &path, const PuzzleTables &puzzle, std::vector<char> &boards) {
+    std::ifstream input(path);
+    std::string error;
+    if (!input) error = "cannot open " + path;
+    if (!input || !readBoardsAsText(input, puzzle, boards, error)) {
+        std::cerr << "Error: " << path << ": " << error << "\n";
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    std::string puzzlePath;
+    size_t nodeLimit = 20000000;
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--puzzle" && i + 1 < argc) {
+            puzzlePath = argv[++i];
+        } else if (arg == "--node-limit" && i + 1 < argc) {
+            nodeLimit = std::strtoull(argv[++i], nullptr, 10);
+        } else if (!arg.empty() && arg[0] != '-') {
+            positional.push_back(arg);
+        } else {
+            positional.clear();
+            break;
+        }
+    }
+    const std::string command = positional.empty() ? "" : positional[0];
+    bool usable = (command == "build" && positional.size() == 2) || (command == "count" && positional.size() <= 3) ||
+                  (command == "list" && positional.size() <= 3) || (command == "contains" && positional.size() == 3);
+    if (!usable || positional.size() < 2) {
+        std::cerr << "Usage: " << argv[0] << " [--puzzle <file>] build <out.dag> [--node-limit <states>]\n"
+                  << "       " << argv[0] << " [--puzzle <file>] count <in.dag> [<partial boards>]\n"
+                  << "       " << argv[0] << " [--puzzle <file>] list <in.dag> [<out.txt>]\n"
+                  << "       " << argv[0] << " [--puzzle <file>] contains <in.dag> <boards>\n";
+        return 1;
+    }
+
+    PuzzleTables puzzle;
+    std::string error;
+    if (!puzzlePath.empty() && !loadPuzzleDefinition(puzzlePath, puzzle, error)) {
+        std::cerr << "Error: " << error << "\n";
+        return 1;
+    }
+    double startTime = wallClockSeconds();
+    precomputeAllPiecePlacements(puzzle);
+
+    SolutionDag dag(puzzle);
+    if (command == "build") {
+        if (!dag.build(nodeLimit, error) || !dag.save(positional[1], error)) {
+            std::cerr << "Error: " << error << "\n";
+            return 1;
+        }
+        std::cout << "Total solutions: " << dag.solutionCount() << "\n";
+        std::cout << "DAG: " << dag.nodeCount() << " nodes, " << dag.edgeCount() << " edges, written to " << positional[1] << "\n";
+        std::cout << "Elapsed time: " << (wallClockSeconds() - startTime) << " seconds\n";
+        return 0;
+    }
+    if (!dag.load(positional[1], error)) {
+        std::cerr << "Error: " << error << "\n";
+        return 1;
+    }
+
+    if (command == "count") {
+        if (positional.size() == 2) {
+            std::cout << "Total solutions: " << dag.solutionCount() << "\n";
+            return 0;
+        }
+        std::vector<char> boards;
+        if (!loadBoards(positional[2], puzzle, boards)) return 1;
+        for (size_t offset = 0; offset < boards.size(); offset += puzzle.totalCells) {
+            unsigned long long count = 0;
+            if (!dag.countCompletions(&boards[offset], count, error)) {
+                std::cerr << "Error: board " << offset / puzzle.totalCells + 1 << ": " << error << "\n";
+                return 1;
+            }
+            std::cout << "Board " << offset / puzzle.totalCells + 1 << ": " << count << " completions\n";
+        }
+    } else if (command == "list") {
+        std::string outputPath = positional.size() == 3 ? positional[2] : "solutions.txt";
+        BlockWriter output(puzzle);
+        if (!output.open(outputPath, false, error)) {
+            std::cerr << "Error: " << error << "\n";
+            return 1;
+        }
+        unsigned long long digest = 0;
+        dag.forEachSolution([&](const char *board) {
+            output.appendBoards(board, 1);
+            digest += digestSolutions(puzzle, board, 1);
+            return true;
+        });
+        if (!output.close(error)) {
+            std::cerr << "Error: " << outputPath << ": " << error << "\n";
+            return 1;
+        }
+        printSolutionTotals(output.boardCount(), digest);
+    } else {
+        std::vector<char> boards;
+        if (!loadBoards(positional[2], puzzle, boards)) return 1;
+        size_t found = 0, total = boards.size() / puzzle.totalCells;
+        for (size_t s = 0; s < total; ++s) {
+            bool solution = dag.contains(&boards[s * puzzle.totalCells]);
+            if (!solution) std::cout << "Board " << s + 1 << ": not a solution\n";
+            found += solution;
+        }
+        std::cout << found << " of " << total << " boards are solutions\n";
+        if (found != total) {
+            std::cout << "Elapsed time: " << (wallClockSeconds() - startTime) << " seconds\n";
+            return 2;
+        }
+    }
+    std::cout << "Elapsed time: " << (wallClockSeconds() - startTime) << " seconds\n";
+    return 0;
+}
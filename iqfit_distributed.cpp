@@ -0,0 +1,429 @@
+// iqfit_distributed.cpp
+// Coordinator and worker loops of the lease-based distribution, and the socket transport
+// used between separate processes (8-byte length prefix, then the encoded message).
+
+#include "iqfit_distributed.h"
+
+#include <iostream>
+#include <fstream>
+#include <deque>
+#include <map>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// Wire format: five fixed header fields followed by the text and the boards
+struct WorkMessageHeader {
+    int32_t type;
+    int32_t leaseId;
+    int32_t unit;
+    uint32_t textLength;
+    uint64_t boardsLength;
+};
+
+std::vector<char> encodeWorkMessage(const WorkMessage &message) {
+    WorkMessageHeader header = { message.type, message.leaseId, message.unit,
+                                 (uint32_t)message.text.size(), (uint64_t)message.boards.size() };
+    std::vector<char> bytes(sizeof(header) + message.text.size() + message.boards.size());
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    std::memcpy(bytes.data() + sizeof(header), message.text.data(), message.text.size());
+    if (!message.boards.empty()) {
+        std::memcpy(bytes.data() + sizeof(header) + message.text.size(), message.boards.data(), message.boards.size());
+    }
+    return bytes;
+}
+
+bool decodeWorkMessage(const char *bytes, size_t length, WorkMessage &message) {
+    WorkMessageHeader header;
+    if (length < sizeof(header)) return false;
+    std::memcpy(&header, bytes, sizeof(header));
+    // Compare by subtraction so huge lengths cannot wrap the sum around to length
+    if (header.textLength > length - sizeof(header)) return false;
+    if (header.boardsLength != length - sizeof(header) - header.textLength) return false;
+    message.type = header.type;
+    message.leaseId = header.leaseId;
+    message.unit = header.unit;
+    message.text.assign(bytes + sizeof(header), header.textLength);
+    message.boards.assign(bytes + sizeof(header) + header.textLength, bytes + length);
+    return true;
+}
+
+bool writeAll(int fd, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t written = ::send(fd, data, length, MSG_NOSIGNAL);
+        if (written <= 0) {
+            if (written < 0 && errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        length -= written;
+    }
+    return true;
+}
+
+bool readAll(int fd, char *data, size_t length) {
+    while (length > 0) {
+        ssize_t received = ::recv(fd, data, length, 0);
+        if (received <= 0) {
+            if (received < 0 && errno == EINTR) continue;
+            return false;
+        }
+        data += received;
+        length -= received;
+    }
+    return true;
+}
+
+// Socket framing: an 8-byte length prefix followed by the encoded message. Workers report
+// once their boards pass MAX_REPORT_BOARD_BYTES, and one search slice (2^20 nodes) adds at
+// most 2^20 boards of at most 256 cells on top, so a longer frame is refused before anything
+// is allocated for it.
+constexpr uint64_t MAX_REPORT_BOARD_BYTES = 64ULL << 20;
+constexpr uint64_t MAX_SOCKET_MESSAGE_BYTES = 512ULL << 20;
+
+static bool sendSocketMessage(int fd, const WorkMessage &message) {
+    std::vector<char> bytes = encodeWorkMessage(message);
+    uint64_t length = bytes.size();
+    return writeAll(fd, (const char *)&length, sizeof(length)) && writeAll(fd, bytes.data(), bytes.size());
+}
+
+static bool receiveSocketMessage(int fd, WorkMessage &message) {
+    uint64_t length = 0;
+    if (!readAll(fd, (char *)&length, sizeof(length)) || length > MAX_SOCKET_MESSAGE_BYTES) return false;
+    std::vector<char> bytes(length);
+    return readAll(fd, bytes.data(), length) && decodeWorkMessage(bytes.data(), bytes.size(), message);
+}
+
+int openSocket(const std::string &address, bool listening, std::string &error) {
+    if (address.compare(0, 5, "unix:") == 0) {
+        sockaddr_un local;
+        std::memset(&local, 0, sizeof(local));
+        local.sun_family = AF_UNIX;
+        std::string path = address.substr(5);
+        if (path.size() >= sizeof(local.sun_path)) {
+            error = "socket path too long: " + path;
+            return -1;
+        }
+        std::strcpy(local.sun_path, path.c_str());
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listening) unlink(path.c_str());
+        if (fd >= 0 && (listening ? (bind(fd, (sockaddr *)&local, sizeof(local)) == 0 && listen(fd, 64) == 0)
+                                  : connect(fd, (sockaddr *)&local, sizeof(local)) == 0)) {
+            return fd;
+        }
+        error = "cannot " + std::string(listening ? "listen on " : "connect to ") + address + ": " + std::strerror(errno);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos) {
+        error = "expected unix:<path> or <host>:<port>, got " + address;
+        return -1;
+    }
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *results = nullptr;
+    std::string host = address.substr(0, colon), port = address.substr(colon + 1);
+    // No host means loopback: nothing here is authenticated, so other machines only get in
+    // when a host such as 0.0.0.0 is named
+    if (getaddrinfo(host.empty() ? "localhost" : host.c_str(), port.c_str(), &hints, &results) != 0) {
+        error = "cannot resolve " + address;
+        return -1;
+    }
+    int fd = -1;
+    for (addrinfo *candidate = results; candidate && fd < 0; candidate = candidate->ai_next) {
+        fd = socket(candidate->ai_family, candidate->ai_socktype, candidate->ai_protocol);
+        if (fd < 0) continue;
+        int reuse = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        bool ok = listening ? (bind(fd, candidate->ai_addr, candidate->ai_addrlen) == 0 && listen(fd, 64) == 0)
+                            : connect(fd, candidate->ai_addr, candidate->ai_addrlen) == 0;
+        if (!ok) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(results);
+    if (fd < 0) error = "cannot " + std::string(listening ? "listen on " : "connect to ") + address;
+    return fd;
+}
+
+// Coordinator for separate worker processes; each connection is one worker
+class SocketCoordinatorTransport : public CoordinatorTransport {
+public:
+    explicit SocketCoordinatorTransport(int listenFd) : listenFd(listenFd) {}
+
+    ~SocketCoordinatorTransport() override {
+        for (int fd : clients) close(fd);
+        close(listenFd);
+    }
+
+    bool receive(int &workerId, WorkMessage &message, double timeoutSeconds) override {
+        double deadline = wallClockSeconds() + timeoutSeconds;
+        while (true) {
+            std::vector<pollfd> watched(1, pollfd{ listenFd, POLLIN, 0 });
+            for (int fd : clients) watched.push_back(pollfd{ fd, POLLIN, 0 });
+            int waitMs = std::max(0, (int)((deadline - wallClockSeconds()) * 1000));
+            if (poll(watched.data(), watched.size(), waitMs) <= 0) return false;
+
+            if (watched[0].revents & POLLIN) {
+                int fd = accept(listenFd, nullptr, nullptr);
+                if (fd >= 0) {
+                    // A worker that stalls halfway through a message must not block the coordinator
+                    timeval readTimeout = { 5, 0 };
+                    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &readTimeout, sizeof(readTimeout));
+                    clients.push_back(fd);
+                }
+            }
+            for (size_t i = 1; i < watched.size(); ++i) {
+                if (!watched[i].revents) continue;
+                workerId = watched[i].fd;
+                if (!(watched[i].revents & POLLIN) || !receiveSocketMessage(workerId, message)) {
+                    disconnect(workerId);
+                    message = WorkMessage();
+                    message.type = MSG_DISCONNECTED;
+                }
+                return true;
+            }
+        }
+    }
+
+    void send(int workerId, const WorkMessage &message) override {
+        if (!sendSocketMessage(workerId, message)) disconnect(workerId);
+    }
+
+private:
+    void disconnect(int fd) {
+        auto it = std::find(clients.begin(), clients.end(), fd);
+        if (it == clients.end()) return;
+        clients.erase(it);
+        close(fd);
+    }
+
+    int listenFd;
+    std::vector<int> clients;
+};
+
+class SocketWorkerTransport : public WorkerTransport {
+public:
+    explicit SocketWorkerTransport(int fd) : fd(fd) {}
+    ~SocketWorkerTransport() override { close(fd); }
+
+    bool exchange(const WorkMessage &request, WorkMessage &reply) override {
+        return sendSocketMessage(fd, request) && receiveSocketMessage(fd, reply);
+    }
+
+private:
+    int fd;
+};
+
+bool runCoordinator(const PuzzleTables &puzzle, CoordinatorTransport &transport, const LeaseOptions &leases,
+                    std::vector<int> expectedWorkers, std::vector<UnitLease> &units) {
+    std::deque<int> pendingUnits;
+    for (int unit = 0; unit < (int)units.size(); ++unit) pendingUnits.push_back(unit);
+    int unitsLeft = units.size();
+    int nextLeaseId = 0;
+    bool lostWorker = false;
+    std::map<int, double> lastSeen;
+    double startTime = wallClockSeconds();
+    for (int workerId : expectedWorkers) lastSeen[workerId] = startTime;
+    std::string fingerprint = std::to_string(puzzleFingerprint(puzzle));
+
+    auto expireLease = [&](int unit) {
+        units[unit].leaseId = -1;
+        units[unit].workerId = -1;
+        pendingUnits.push_front(unit);
+    };
+
+    while (unitsLeft > 0 || !expectedWorkers.empty()) {
+        // Reclaim units whose lease ran out
+        double now = wallClockSeconds();
+        for (int unit = 0; unit < (int)units.size(); ++unit) {
+            if (!units[unit].done && units[unit].leaseId >= 0 && now > units[unit].deadline) {
+                std::cerr << "Coordinator: lease on unit " << unit << " expired (worker " << units[unit].workerId
+                          << "); reissuing from its last reported position\n";
+                expireLease(unit);
+            }
+        }
+        // Once everything is done, stop waiting for workers that went silent
+        if (unitsLeft == 0) {
+            for (auto it = expectedWorkers.begin(); it != expectedWorkers.end();) {
+                if (now - lastSeen[*it] > leases.leaseSeconds) {
+                    std::cerr << "Coordinator: giving up on silent worker " << *it << "\n";
+                    lostWorker = true;
+                    it = expectedWorkers.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            if (expectedWorkers.empty()) break;
+        }
+
+        int workerId;
+        WorkMessage request;
+        if (!transport.receive(workerId, request, 0.25)) continue;
+        lastSeen[workerId] = wallClockSeconds();
+        WorkMessage reply;
+        reply.type = MSG_ACK;
+
+        if (request.type == MSG_DISCONNECTED) {
+            for (int unit = 0; unit < (int)units.size(); ++unit) {
+                if (!units[unit].done && units[unit].leaseId >= 0 && units[unit].workerId == workerId) {
+                    std::cerr << "Coordinator: worker " << workerId << " disconnected; reissuing unit " << unit << "\n";
+                    expireLease(unit);
+                }
+            }
+            continue;
+        }
+
+        if (request.type == MSG_REQUEST_WORK) {
+            if (request.text != fingerprint || unitsLeft == 0) {
+                if (request.text != fingerprint) std::cerr << "Coordinator: worker " << workerId << " loaded a different puzzle\n";
+                reply.type = MSG_NO_MORE_WORK;
+                expectedWorkers.erase(std::remove(expectedWorkers.begin(), expectedWorkers.end(), workerId), expectedWorkers.end());
+            } else if (pendingUnits.empty()) {
+                // Every remaining unit is leased; the worker asks again in case one is reissued
+                reply.type = MSG_ACK;
+            } else {
+                int unit = pendingUnits.front();
+                pendingUnits.pop_front();
+                units[unit].leaseId = nextLeaseId++;
+                units[unit].workerId = workerId;
+                units[unit].deadline = wallClockSeconds() + leases.leaseSeconds;
+                reply.type = MSG_LEASE;
+                reply.unit = unit;
+                reply.leaseId = units[unit].leaseId;
+                reply.text = units[unit].resumeState;
+            }
+        } else if (request.type == MSG_HEARTBEAT || request.type == MSG_UNIT_DONE) {
+            bool validUnit = request.unit >= 0 && request.unit < (int)units.size();
+            UnitLease *lease = validUnit ? &units[request.unit] : nullptr;
+            if (!lease || lease->done || lease->leaseId != request.leaseId) {
+                // Stale report from a worker whose lease was already reissued
+                reply.type = MSG_LEASE_REVOKED;
+            } else {
+                lease->boards.insert(lease->boards.end(), request.boards.begin(), request.boards.end());
+                lease->deadline = wallClockSeconds() + leases.leaseSeconds;
+                if (request.type == MSG_HEARTBEAT) {
+                    lease->resumeState = request.text;
+                } else {
+                    lease->done = true;
+                    lease->leaseId = -1;
+                    --unitsLeft;
+                }
+            }
+        }
+        transport.send(workerId, reply);
+    }
+    return !lostWorker;
+}
+
+// Worker loop: lease a unit, search it in slices, report progress, repeat
+template <typename BoardMask>
+static void runWorker(const PuzzleTables &puzzle, WorkerTransport &transport, const LeaseOptions &leases) {
+    auto piecePlacementMasks = buildPlacementMasks<BoardMask>(puzzle);
+    SearchStart<BoardMask> start = emptyBoardStart<BoardMask>(puzzle);
+
+    const long long nodesPerSlice = 1LL << 20;
+    WorkMessage request, reply;
+    while (true) {
+        request = WorkMessage();
+        request.type = MSG_REQUEST_WORK;
+        request.text = std::to_string(puzzleFingerprint(puzzle));
+        if (!transport.exchange(request, reply) || reply.type == MSG_NO_MORE_WORK) return;
+        if (reply.type != MSG_LEASE) {
+            // Nothing to hand out right now, but leased units may still be reissued
+            usleep(200000);
+            continue;
+        }
+
+        SearchState state;
+        if (!reply.text.empty() && !parseSearchState(reply.text, state)) return;
+        state.unit = reply.unit;
+        int leaseId = reply.leaseId;
+        std::vector<char> newBoards;
+        double lastHeartbeat = wallClockSeconds();
+
+        SearchStatus status;
+        do {
+            status = resumeSearch(puzzle, piecePlacementMasks, start, state, nodesPerSlice, AppendSolutions{newBoards, puzzle.totalCells});
+            if (status == SEARCH_INVALID_STATE) return;
+            if (status == SEARCH_FINISHED || wallClockSeconds() - lastHeartbeat >= leases.heartbeatSeconds ||
+                newBoards.size() >= MAX_REPORT_BOARD_BYTES) {
+                request = WorkMessage();
+                request.type = status == SEARCH_FINISHED ? MSG_UNIT_DONE : MSG_HEARTBEAT;
+                request.unit = state.unit;
+                request.leaseId = leaseId;
+                request.text = serializeSearchState(state);
+                request.boards.swap(newBoards);
+                newBoards.clear();
+                if (!transport.exchange(request, reply)) return;
+                if (reply.type == MSG_LEASE_REVOKED) break;
+                lastHeartbeat = wallClockSeconds();
+            }
+        } while (status == SEARCH_PAUSED);
+    }
+}
+
+void runWorkerForBoard(const PuzzleTables &puzzle, WorkerTransport &transport, const LeaseOptions &leases) {
+    switch ((puzzle.totalCells + 63) / 64) {
+        case 1: runWorker<uint64_t>(puzzle, transport, leases); break;
+        case 2: runWorker<MultiWordMask<2>>(puzzle, transport, leases); break;
+        case 3: runWorker<MultiWordMask<3>>(puzzle, transport, leases); break;
+        default: runWorker<MultiWordMask<4>>(puzzle, transport, leases); break;
+    }
+}
+
+void writeCoordinatorResults(const PuzzleTables &puzzle, const std::vector<UnitLease> &units) {
+    std::ofstream outputFile("solutions.txt");
+    if (!outputFile.is_open()) {
+        std::cerr << "Error: Could not open solutions.txt\n";
+        return;
+    }
+    unsigned long long totalSolutions = 0, digest = 0;
+    for (const auto &unit : units) {
+        size_t boardCount = unit.boards.size() / puzzle.totalCells;
+        writeBoardsAsText(outputFile, puzzle, unit.boards.data(), boardCount);
+        totalSolutions += boardCount;
+        digest += digestSolutions(puzzle, unit.boards.data(), boardCount);
+    }
+    outputFile.close();
+    printSolutionTotals(totalSolutions, digest);
+}
+
+bool runSocketCoordinator(const PuzzleTables &puzzle, const std::string &address, const LeaseOptions &leases) {
+    std::string error;
+    int listenFd = openSocket(address, true, error);
+    if (listenFd < 0) {
+        std::cerr << "Error: " << error << "\n";
+        return false;
+    }
+    SocketCoordinatorTransport transport(listenFd);
+    std::vector<UnitLease> units(puzzle.piecePlacementCells[0].size());
+    runCoordinator(puzzle, transport, leases, std::vector<int>(), units);
+    writeCoordinatorResults(puzzle, units);
+    return true;
+}
+
+bool runSocketWorker(const PuzzleTables &puzzle, const std::string &address, const LeaseOptions &leases) {
+    std::string error;
+    int fd = -1;
+    for (int attempt = 0; attempt < 50 && fd < 0; ++attempt) {
+        fd = openSocket(address, false, error);
+        if (fd < 0) usleep(200000);
+    }
+    if (fd < 0) {
+        std::cerr << "Error: " << error << "\n";
+        return false;
+    }
+    SocketWorkerTransport transport(fd);
+    runWorkerForBoard(puzzle, transport, leases);
+    return true;
+}
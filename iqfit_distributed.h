@@ -0,0 +1,97 @@
+// iqfit_distributed.h
+// Dynamic, fault-tolerant distribution. A coordinator leases work units to workers.
+// Workers report progress in heartbeats that carry their boards so far and their
+// serialized search position. A lease that is not renewed before it expires (crashed,
+// hung or disconnected worker) goes back to the queue and resumes from the last
+// reported position on another worker. The socket transport lives here; the MPI
+// transport (rank 0 coordinates) is part of iqfit_mpi.cpp.
+
+#ifndef IQFIT_DISTRIBUTED_H
+#define IQFIT_DISTRIBUTED_H
+
+#include "iqfit_core.h"
+
+enum WorkMessageType {
+    MSG_REQUEST_WORK = 1,   // worker -> coordinator (text = puzzle fingerprint)
+    MSG_LEASE,              // coordinator -> worker (unit, leaseId, text = position to resume from)
+    MSG_NO_MORE_WORK,       // coordinator -> worker
+    MSG_HEARTBEAT,          // worker -> coordinator (text = current position, boards since last report)
+    MSG_UNIT_DONE,          // worker -> coordinator (boards since last report)
+    MSG_ACK,                // coordinator -> worker
+    MSG_LEASE_REVOKED,      // coordinator -> worker: the lease expired, drop the unit
+    MSG_DISCONNECTED        // generated by the socket transport when a worker goes away
+};
+
+struct WorkMessage {
+    int type = 0;
+    int leaseId = -1;
+    int unit = -1;
+    std::string text;
+    std::vector<char> boards;
+};
+
+// Wire format: five fixed header fields followed by the text and the boards
+std::vector<char> encodeWorkMessage(const WorkMessage &message);
+bool decodeWorkMessage(const char *bytes, size_t length, WorkMessage &message);
+
+// Coordinator side of a transport: messages from any worker, replies to one worker
+class CoordinatorTransport {
+public:
+    virtual ~CoordinatorTransport() {}
+    // Wait up to timeoutSeconds for the next message; false on timeout
+    virtual bool receive(int &workerId, WorkMessage &message, double timeoutSeconds) = 0;
+    virtual void send(int workerId, const WorkMessage &message) = 0;
+};
+
+// Worker side of a transport: every message gets exactly one reply
+class WorkerTransport {
+public:
+    virtual ~WorkerTransport() {}
+    // Send a message and wait for the coordinator's reply; false if the coordinator is gone
+    virtual bool exchange(const WorkMessage &request, WorkMessage &reply) = 0;
+};
+
+// Socket helpers, also used by the solve server. openSocket returns a listening or
+// connected socket for "unix:<path>" or "<host>:<port>" (TCP; ":<port>" is loopback), or -1
+// with error set.
+int openSocket(const std::string &address, bool listening, std::string &error);
+bool writeAll(int fd, const char *data, size_t length);
+bool readAll(int fd, char *data, size_t length);
+
+// Lease timing, taken from the command line
+struct LeaseOptions {
+    double leaseSeconds = 30.0;       // a unit is reissued if its lease is not renewed in time
+    double heartbeatSeconds = 5.0;    // how often a worker renews its lease
+};
+
+// Coordinator bookkeeping for one work unit
+struct UnitLease {
+    int leaseId = -1;            // current lease (-1 = waiting in the queue)
+    int workerId = -1;
+    double deadline = 0.0;
+    bool done = false;
+    std::string resumeState;     // last position reported for the unit ("" = from the start)
+    std::vector<char> boards;    // boards received so far, in search order
+};
+
+// Hand out units until all are done, reissuing expired leases. expectedWorkers lists
+// workers that must be told to stop before returning (the MPI ranks); socket workers
+// simply see the connection close. Returns false if some worker was given up on.
+bool runCoordinator(const PuzzleTables &puzzle, CoordinatorTransport &transport, const LeaseOptions &leases,
+                    std::vector<int> expectedWorkers, std::vector<UnitLease> &units);
+
+// Worker loop (lease a unit, search it in slices, report progress, repeat) with the
+// narrowest mask that holds the board
+void runWorkerForBoard(const PuzzleTables &puzzle, WorkerTransport &transport, const LeaseOptions &leases);
+
+// Write the coordinator's boards in unit order and print totals
+void writeCoordinatorResults(const PuzzleTables &puzzle, const std::vector<UnitLease> &units);
+
+// Coordinate separate worker processes over "unix:<path>" or "<host>:<port>" (TCP) and
+// write the results; false if the address cannot be listened on
+bool runSocketCoordinator(const PuzzleTables &puzzle, const std::string &address, const LeaseOptions &leases);
+
+// Connect to a socket coordinator, retrying while it starts up, and work until it is done
+bool runSocketWorker(const PuzzleTables &puzzle, const std::string &address, const LeaseOptions &leases);
+
+#endif // IQFIT_DISTRIBUTED_H
@@ -0,0 +1,168 @@
+// iqfit_loadgen.cpp
+// Load generator for iqfit_server: replays a file of recorded challenge requests over
+// several connections (closed loop: each connection sends its next request as soon as the
+// previous answer arrives) and reports throughput and latency percentiles.
+//
+// The challenge file holds one request per line in the server protocol ("solve <max>
+// <board>" or "count <board>"); blank lines and lines starting with '#' are skipped.
+// Requests are replayed in file order, wrapping around until --requests have been sent.
+
+#include "iqfit_core.h"
+#include "iqfit_distributed.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/socket.h>
+
+struct LoadOptions {
+    std::string address;
+    std::string challengePath;
+    int connections = 4;
+    long long requests = 1000;
+};
+
+// Line reader over a connected socket
+class LineReader {
+public:
+    explicit LineReader(int fd) : fd(fd) {}
+
+    bool readLine(std::string &line) {
+        size_t newline;
+        while ((newline = buffered.find('\n')) == std::string::npos) {
+            char chunk[4096];
+            ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+            if (received <= 0) return false;
+            buffered.append(chunk, received);
+        }
+        line = buffered.substr(0, newline);
+        buffered.erase(0, newline + 1);
+        return true;
+    }
+
+private:
+    int fd;
+    std::string buffered;
+};
+
+static bool loadChallenges(const std::string &path, std::vector<std::string> &challenges) {
+    std::ifstream input(path);
+    if (!input) {
+        std::cerr << "Error: cannot open challenge file " << path << "\n";
+        return false;
+    }
+    std::string line;
+    while (std::getline(input, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+        challenges.push_back(line + "\n");
+    }
+    if (challenges.empty()) {
+        std::cerr << "Error: no requests in " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+struct ConnectionTotals {
+    std::vector<double> latenciesMs;
+    long long errors = 0;
+};
+
+// Send requests until the shared counter runs out; record the latency of every answer
+static void runConnection(const LoadOptions &options, const std::vector<std::string> &challenges,
+                          std::atomic<long long> &nextRequest, ConnectionTotals &totals) {
+    std::string error;
+    int fd = openSocket(options.address, false, error);
+    if (fd < 0) {
+        std::cerr << "Error: " << error << "\n";
+        totals.errors = -1;
+        return;
+    }
+    LineReader reader(fd);
+    for (long long index = nextRequest++; index < options.requests; index = nextRequest++) {
+        const std::string &request = challenges[index % challenges.size()];
+        double sentAt = wallClockSeconds();
+        if (!writeAll(fd, request.data(), request.size())) {
+            ++totals.errors;
+            break;
+        }
+        std::string header;
+        if (!reader.readLine(header)) {
+            ++totals.errors;
+            break;
+        }
+        // "ok <returned> ..." is followed by <returned> board lines
+        std::istringstream fields(header);
+        std::string status;
+        long long returned = 0;
+        fields >> status >> returned;
+        bool complete = status == "ok";
+        std::string board;
+        for (long long b = 0; complete && b < returned; ++b) complete = reader.readLine(board);
+        totals.latenciesMs.push_back((wallClockSeconds() - sentAt) * 1000.0);
+        if (!complete) ++totals.errors;
+        if (status == "ok" && !complete) break;
+    }
+    close(fd);
+}
+
+int main(int argc, char **argv) {
+    LoadOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--connect" && i + 1 < argc) {
+            options.address = argv[++i];
+        } else if (arg == "--challenges" && i + 1 < argc) {
+            options.challengePath = argv[++i];
+        } else if (arg == "--connections" && i + 1 < argc) {
+            options.connections = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--requests" && i + 1 < argc) {
+            options.requests = std::max(1LL, std::atoll(argv[++i]));
+        } else {
+            options.address.clear();
+            break;
+        }
+    }
+    if (options.address.empty() || options.challengePath.empty()) {
+        std::cerr << "Usage: " << argv[0] << " --connect <addr> --challenges <file>"
+                  << " [--connections <count>] [--requests <count>]\n";
+        return 1;
+    }
+
+    std::vector<std::string> challenges;
+    if (!loadChallenges(options.challengePath, challenges)) return 1;
+
+    std::atomic<long long> nextRequest(0);
+    std::vector<ConnectionTotals> totals(options.connections);
+    std::vector<std::thread> connections;
+    double startTime = wallClockSeconds();
+    for (int c = 0; c < options.connections; ++c) {
+        connections.emplace_back(runConnection, std::cref(options), std::cref(challenges),
+                                 std::ref(nextRequest), std::ref(totals[c]));
+    }
+    for (auto &connection : connections) connection.join();
+    double elapsed = wallClockSeconds() - startTime;
+
+    std::vector<double> latencies;
+    long long errors = 0;
+    for (const ConnectionTotals &connection : totals) {
+        if (connection.errors < 0) return 1;
+        latencies.insert(latencies.end(), connection.latenciesMs.begin(), connection.latenciesMs.end());
+        errors += connection.errors;
+    }
+    double maxMs = latencies.empty() ? 0.0 : *std::max_element(latencies.begin(), latencies.end());
+    std::printf("Requests: %zu over %d connections (%lld errors)\n", latencies.size(), options.connections, errors);
+    std::printf("Elapsed: %.3f s, %.1f requests/s\n", elapsed, latencies.size() / std::max(elapsed, 1e-9));
+    std::printf("Latency: p50 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+                percentileOf(latencies, 0.50), percentileOf(latencies, 0.99), maxMs);
+    return errors == 0 ? 0 : 2;
+}
@@ -1,171 +1,253 @@
 // iqfit_mpi.cpp (Translated to English, with meaningful variable names and enhanced comments)
 // MPI-based parallel solver for the IQ-Fit puzzle (11x5 board, 12 unique pieces).
 // Each MPI rank explores a disjoint set of possible placements for the first piece.
+// Other boards and piece sets can be loaded at startup from a puzzle definition file (--puzzle).
+// The puzzle model and search live in iqfit_core, checkpoints in iqfit_checkpoint and the
+// lease-based distribution in iqfit_distributed; this file adds the MPI layer on top.
 
 #include <mpi.h>
+#include "iqfit_core.h"
+#include "iqfit_checkpoint.h"
+#include "iqfit_distributed.h"
+#include "iqfit_analytics.h"
+#include "iqfit_affinity.h"
+#include "iqfit_output.h"
+#include "iqfit_compress.h"
 #include <iostream>
 #include <vector>
 #include <string>
-#include <set>
-#include <algorithm>
-#include <cstdint>
-#include <cstring>
 #include <fstream>
 #include <numeric>
-#include <array>
-
-// Board and puzzle parameters
-constexpr int BOARD_WIDTH = 11;
-constexpr int BOARD_HEIGHT = 5;
-constexpr int TOTAL_CELLS = BOARD_WIDTH * BOARD_HEIGHT;
-constexpr int TOTAL_PIECES = 12;
-
-// Each shape string defines a base piece using "xy" format 
-static const std::vector<std::string> basePieceShapes = {
-    "01 10 11 21 31", "01 10 11 21 22", "10 11 12 13 03",
-    "01 11 10 02", "00 01 02 12 13", "02 12 11 21 20",
-    "02 12 11 10", "02 12 22 21 20", "01 11 10",
-    "01 02 11 12 10", "01 11 10 21", "00 01 11 21 20"
-};
+#include <list>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
 
-// Precomputed bitmask placements for each piece and its variations
-std::vector<std::vector<uint64_t>> piecePlacementMasks(TOTAL_PIECES);
-// List of board cell indices covered by each valid placement
-std::vector<std::vector<std::vector<int>>> piecePlacementCells(TOTAL_PIECES);
-// For each piece and board cell: which placements cover that cell
-std::vector<std::vector<std::vector<int>>> piecePlacementsByCell(TOTAL_PIECES, std::vector<std::vector<int>>(TOTAL_CELLS));
-
-// Representation of the board as a 1D character array
-using BoardRepresentation = std::array<char, TOTAL_CELLS>;
-
-// Parse a piece shape string into a list of coordinate pairs
-static std::vector<std::pair<int,int>> parsePieceShape(const std::string &shapeStr) {
-    std::vector<std::pair<int,int>> coordinates;
-    for (size_t i = 0; i + 1 < shapeStr.size(); i += 3) {
-        int x = shapeStr[i] - '0';
-        int y = shapeStr[i+1] - '0';
-        coordinates.emplace_back(x, y);
-    }
-    return coordinates;
-}
+constexpr int WORK_MESSAGE_TAG = 57;
+constexpr int SOLUTION_CHUNK_TAG = 58;
 
-// Generate all unique orientations (rotations + reflections) of a piece
-static std::vector<std::vector<std::pair<int,int>>> generateUniqueOrientations(const std::vector<std::pair<int,int>> &baseCoords) {
-    std::set<std::vector<std::pair<int,int>>> uniqueOrientations;
-    for (int reflect = 0; reflect < 2; ++reflect) {
-        for (int rot = 0; rot < 4; ++rot) {
-            std::vector<std::pair<int,int>> transformed;
-            for (const auto &coord : baseCoords) {
-                int x = reflect ? -coord.first : coord.first;
-                int y = coord.second;
-                for (int r = 0; r < rot; ++r) {
-                    int temp = x;
-                    x = y;
-                    y = -temp;
-                }
-                transformed.emplace_back(x, y);
-            }
-            // Normalize to top-left origin
-            int minX = INT32_MAX, minY = INT32_MAX;
-            for (const auto &p : transformed) {
-                minX = std::min(minX, p.first);
-                minY = std::min(minY, p.second);
-            }
-            for (auto &p : transformed) {
-                p.first -= minX;
-                p.second -= minY;
+// Rank 0 coordinates the other ranks with point-to-point messages
+class MpiCoordinatorTransport : public CoordinatorTransport {
+public:
+    bool receive(int &workerId, WorkMessage &message, double timeoutSeconds) override {
+        double deadline = MPI_Wtime() + timeoutSeconds;
+        while (true) {
+            int ready = 0;
+            MPI_Status status;
+            MPI_Iprobe(MPI_ANY_SOURCE, WORK_MESSAGE_TAG, MPI_COMM_WORLD, &ready, &status);
+            if (ready) {
+                int length = 0;
+                MPI_Get_count(&status, MPI_BYTE, &length);
+                std::vector<char> bytes(length);
+                MPI_Recv(bytes.data(), length, MPI_BYTE, status.MPI_SOURCE, WORK_MESSAGE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                workerId = status.MPI_SOURCE;
+                if (decodeWorkMessage(bytes.data(), bytes.size(), message)) return true;
+                continue;
             }
-            std::sort(transformed.begin(), transformed.end());
-            uniqueOrientations.insert(transformed);
+            if (MPI_Wtime() >= deadline) return false;
+            usleep(200);
         }
     }
-    return std::vector<std::vector<std::pair<int,int>>>(uniqueOrientations.begin(), uniqueOrientations.end());
-}
 
-// Precompute all legal placements for every piece in all orientations
-static void precomputeAllPiecePlacements() {
-    for (int pieceIdx = 0; pieceIdx < TOTAL_PIECES; ++pieceIdx) {
-        auto baseCoords = parsePieceShape(basePieceShapes[pieceIdx]);
-        auto allOrientations = generateUniqueOrientations(baseCoords);
-
-        for (const auto &shape : allOrientations) {
-            int maxX = 0, maxY = 0;
-            for (const auto &coord : shape) {
-                maxX = std::max(maxX, coord.first);
-                maxY = std::max(maxY, coord.second);
-            }
-            int shapeWidth = maxX + 1;
-            int shapeHeight = maxY + 1;
-
-            for (int yOffset = 0; yOffset <= BOARD_HEIGHT - shapeHeight; ++yOffset) {
-                for (int xOffset = 0; xOffset <= BOARD_WIDTH - shapeWidth; ++xOffset) {
-                    uint64_t placementMask = 0ULL;
-                    std::vector<int> cellIndices;
-                    bool validPlacement = true;
-                    for (const auto &coord : shape) {
-                        int x = xOffset + coord.first;
-                        int y = yOffset + coord.second;
-                        int cellIdx = y * BOARD_WIDTH + x;
-                        if (cellIdx < 0 || cellIdx >= TOTAL_CELLS) {
-                            validPlacement = false;
-                            break;
-                        }
-                        placementMask |= (1ULL << cellIdx);
-                        cellIndices.push_back(cellIdx);
-                    }
-                    if (!validPlacement) continue;
-                    int placementIdx = piecePlacementMasks[pieceIdx].size();
-                    piecePlacementMasks[pieceIdx].push_back(placementMask);
-                    piecePlacementCells[pieceIdx].push_back(cellIndices);
-                    for (int cell : cellIndices) {
-                        piecePlacementsByCell[pieceIdx][cell].push_back(placementIdx);
-                    }
+    void send(int workerId, const WorkMessage &message) override {
+        std::vector<char> bytes = encodeWorkMessage(message);
+        MPI_Send(bytes.data(), bytes.size(), MPI_BYTE, workerId, WORK_MESSAGE_TAG, MPI_COMM_WORLD);
+    }
+};
+
+class MpiWorkerTransport : public WorkerTransport {
+public:
+    bool exchange(const WorkMessage &request, WorkMessage &reply) override {
+        std::vector<char> bytes = encodeWorkMessage(request);
+        MPI_Send(bytes.data(), bytes.size(), MPI_BYTE, 0, WORK_MESSAGE_TAG, MPI_COMM_WORLD);
+        MPI_Status status;
+        MPI_Probe(0, WORK_MESSAGE_TAG, MPI_COMM_WORLD, &status);
+        int length = 0;
+        MPI_Get_count(&status, MPI_BYTE, &length);
+        bytes.resize(length);
+        MPI_Recv(bytes.data(), length, MPI_BYTE, 0, WORK_MESSAGE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        return decodeWorkMessage(bytes.data(), bytes.size(), reply);
+    }
+};
+
+// Ships a rank's boards to rank 0 in chunks while the rank keeps searching. A chunk stays
+// alive until its MPI_Isend completes; an empty message tells rank 0 the rank is done.
+class ChunkSender {
+public:
+    explicit ChunkSender(size_t chunkBytes) : chunkBytes(chunkBytes) {}
+
+    // Send the buffer (leaving it empty) once it holds a full chunk
+    void offer(std::vector<char> &boards) {
+        releaseCompleted();
+        if (boards.size() >= chunkBytes) send(boards);
+    }
+
+    // Send what is left and the end marker, then wait for every chunk to be delivered
+    void finish(std::vector<char> &boards) {
+        if (!boards.empty()) send(boards);
+        std::vector<char> endMarker;
+        send(endMarker);
+        for (PendingChunk &chunk : pending) MPI_Wait(&chunk.request, MPI_STATUS_IGNORE);
+        pending.clear();
+    }
+
+private:
+    struct PendingChunk {
+        std::vector<char> boards;
+        MPI_Request request;
+    };
+
+    void send(std::vector<char> &boards) {
+        pending.emplace_back();
+        PendingChunk &chunk = pending.back();
+        chunk.boards.swap(boards);
+        boards.reserve(chunkBytes);
+        MPI_Isend(chunk.boards.data(), chunk.boards.size(), MPI_CHAR, 0, SOLUTION_CHUNK_TAG, MPI_COMM_WORLD, &chunk.request);
+    }
+
+    void releaseCompleted() {
+        pending.remove_if([](PendingChunk &chunk) {
+            int done = 0;
+            MPI_Test(&chunk.request, &done, MPI_STATUS_IGNORE);
+            return done != 0;
+        });
+    }
+
+    size_t chunkBytes;
+    std::list<PendingChunk> pending;
+};
+
+// Rank 0's side: hand chunks to the block writer as they arrive, in arrival order
+class ChunkReceiver {
+public:
+    ChunkReceiver(const PuzzleTables &puzzle, BlockWriter &output, int senders)
+        : puzzle(puzzle), output(output), sendersLeft(senders) {}
+
+    void write(const std::vector<char> &boards) {
+        output.appendBoards(boards.data(), boards.size() / puzzle.totalCells);
+    }
+
+    // Take whatever chunks have arrived, without waiting
+    void poll() {
+        int arrived = 1;
+        while (sendersLeft > 0) {
+            MPI_Status status;
+            MPI_Iprobe(MPI_ANY_SOURCE, SOLUTION_CHUNK_TAG, MPI_COMM_WORLD, &arrived, &status);
+            if (!arrived) break;
+            receive(status);
+        }
+    }
+
+    // Block until every sender has sent its end marker
+    void drain() {
+        while (sendersLeft > 0) {
+            MPI_Status status;
+            MPI_Probe(MPI_ANY_SOURCE, SOLUTION_CHUNK_TAG, MPI_COMM_WORLD, &status);
+            receive(status);
+        }
+    }
+
+private:
+    void receive(const MPI_Status &status) {
+        int length = 0;
+        MPI_Get_count(&status, MPI_CHAR, &length);
+        chunk.resize(length);
+        MPI_Recv(chunk.data(), length, MPI_CHAR, status.MPI_SOURCE, SOLUTION_CHUNK_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        if (length == 0) {
+            --sendersLeft;
+        } else {
+            write(chunk);
+        }
+    }
+
+    const PuzzleTables &puzzle;
+    BlockWriter &output;
+    int sendersLeft;
+    std::vector<char> chunk;
+};
+
+struct StreamOptions {
+    bool enabled = false;
+    size_t chunkBoards = 4096;
+    bool writerRank = false;    // rank 0 only writes; ranks 1..N-1 search
+    bool directIo = false;
+};
+
+// Static distribution with the output overlapped: ranks stream chunks to rank 0 between search
+// slices, and rank 0 formats them into blocks that a background thread writes while the search
+// goes on, so nothing is left to gather once the search ends. Rank 0 either searches too
+// (writing its own boards the same way) or is dedicated to the output.
+static void searchAndStreamSolutions(const PuzzleTables &puzzle, int rankId, int totalRanks, const StreamOptions &stream, double startTime) {
+    const size_t chunkBytes = stream.chunkBoards * puzzle.totalCells;
+    RankProgress progress;
+    std::vector<char> localBuffer;
+    CheckpointOptions noCheckpoints;
+    unsigned long long boardsWritten = 0;
+    if (rankId == 0) {
+        BlockWriter output(puzzle);
+        std::string error;
+        bool opened = output.open("solutions.txt", stream.directIo, error);
+        if (!opened) std::cerr << "Error: " << error << "\n";
+        ChunkReceiver receiver(puzzle, output, totalRanks - 1);
+        if (!stream.writerRank) {
+            searchAssignedPlacementsForBoard(puzzle, rankId, totalRanks, noCheckpoints, progress, localBuffer, [&]() {
+                if (localBuffer.size() >= chunkBytes) {
+                    receiver.write(localBuffer);
+                    localBuffer.clear();
                 }
-            }
+                receiver.poll();
+            });
+            receiver.write(localBuffer);
         }
+        receiver.drain();
+        boardsWritten = output.boardCount();
+        if (opened && !output.close(error)) std::cerr << "Error: solutions.txt: " << error << "\n";
+    } else {
+        // With a writer rank, search rank r works as rank r-1 of the N-1 searching ranks
+        int searchRank = stream.writerRank ? rankId - 1 : rankId;
+        int searchRanks = stream.writerRank ? totalRanks - 1 : totalRanks;
+        ChunkSender sender(chunkBytes);
+        searchAssignedPlacementsForBoard(puzzle, searchRank, searchRanks, noCheckpoints, progress, localBuffer,
+                                         [&]() { sender.offer(localBuffer); });
+        sender.finish(localBuffer);
     }
-}
 
-// Recursive backtracking search to find valid solutions
-static void recursiveSolver(
-    uint64_t currentBoardMask,
-    std::array<bool, TOTAL_PIECES> &usedPieces,
-    BoardRepresentation &currentBoard,
-    std::vector<BoardRepresentation> &foundSolutions
-) {
-    // Base case: all pieces placed
-    if (std::all_of(usedPieces.begin(), usedPieces.end(), [](bool used) { return used; })) {
-        foundSolutions.push_back(currentBoard);
-        return;
-    }
-
-    // Find the first empty cell
-    int firstEmptyCell = 0;
-    while (firstEmptyCell < TOTAL_CELLS && ((currentBoardMask >> firstEmptyCell) & 1ULL)) {
-        ++firstEmptyCell;
-    }
-    if (firstEmptyCell >= TOTAL_CELLS) return;
-
-    // Try all unused pieces that can cover the current cell
-    for (int pieceIdx = 0; pieceIdx < TOTAL_PIECES; ++pieceIdx) {
-        if (usedPieces[pieceIdx]) continue;
-        for (int placementIdx : piecePlacementsByCell[pieceIdx][firstEmptyCell]) {
-            uint64_t placementMask = piecePlacementMasks[pieceIdx][placementIdx];
-            if ((placementMask & currentBoardMask) != 0ULL) continue;
-
-            // Place the piece
-            usedPieces[pieceIdx] = true;
-            uint64_t newMask = currentBoardMask | placementMask;
-            for (int cell : piecePlacementCells[pieceIdx][placementIdx]) {
-                currentBoard[cell] = char('A' + pieceIdx);
-            }
-            recursiveSolver(newMask, usedPieces, currentBoard, foundSolutions);
-            // Backtrack
-            usedPieces[pieceIdx] = false;
-            for (int cell : piecePlacementCells[pieceIdx][placementIdx]) {
-                currentBoard[cell] = '.';
-            }
+    unsigned long long localTotals[2] = { progress.solutionCount, progress.solutionDigest };
+    unsigned long long globalTotals[2] = { 0, 0 };
+    MPI_Reduce(localTotals, globalTotals, 2, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (rankId == 0) {
+        if (boardsWritten != globalTotals[0]) {
+            std::cerr << "Warning: solutions.txt holds " << boardsWritten << " of " << globalTotals[0] << " solutions\n";
         }
+        printSolutionTotals(globalTotals[0], globalTotals[1]);
+        std::cout << "Elapsed time: " << (MPI_Wtime() - startTime) << " seconds\n";
+    }
+}
+
+// Pin this rank by its rank among the ranks on the same host; rank 0 prints the topology it
+// sees and every rank's placement
+static void pinRankAndReport(PinMode pinMode, int numaNodes, int rankId, int totalRanks) {
+    MPI_Comm hostComm;
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rankId, MPI_INFO_NULL, &hostComm);
+    int localRank;
+    MPI_Comm_rank(hostComm, &localRank);
+    MPI_Comm_free(&hostComm);
+
+    NumaTopology topology = discoverTopology(numaNodes);
+    WorkerPlacement placement = placeWorker(topology, pinMode, localRank);
+    std::string error, description = describePlacement(topology, placement);
+    if (!pinCurrentThread(placement, error)) description += " (failed: " + error + ")";
+
+    char hostName[64] = {};
+    gethostname(hostName, sizeof(hostName) - 1);
+    char line[256] = {};
+    std::snprintf(line, sizeof(line), "Rank %d on %s: %s", rankId, hostName, description.c_str());
+    std::vector<char> lines(rankId == 0 ? totalRanks * sizeof(line) : 0);
+    MPI_Gather(line, sizeof(line), MPI_CHAR, lines.data(), sizeof(line), MPI_CHAR, 0, MPI_COMM_WORLD);
+    if (rankId == 0) {
+        std::cout << "Topology: " << describeTopology(topology) << "\n";
+        for (int r = 0; r < totalRanks; ++r) std::cout << &lines[r * sizeof(line)] << "\n";
     }
 }
 
@@ -175,30 +257,233 @@ int main(int argc, char **argv) {
     MPI_Comm_size(MPI_COMM_WORLD, &totalRanks);
     MPI_Comm_rank(MPI_COMM_WORLD, &rankId);
 
+    // Optional puzzle definition file (defaults to the built-in 11x5 IQ-Fit set)
+    // and checkpoint settings for long enumerations
+    std::string puzzlePath;
+    PuzzleTables puzzle;
+    CheckpointOptions checkpoints;
+    LeaseOptions leases;
+    bool dynamicDistribution = false;
+    std::string coordinatorAddress, workerAddress, analyticsPrefix;
+    PinMode pinMode = PIN_NONE;
+    int numaNodes = 0;
+    StreamOptions stream;
+    bool compressOutput = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--puzzle" && i + 1 < argc) {
+            puzzlePath = argv[++i];
+        } else if (arg == "--checkpoint-dir" && i + 1 < argc) {
+            checkpoints.directory = argv[++i];
+        } else if (arg == "--checkpoint-interval" && i + 1 < argc) {
+            checkpoints.intervalSeconds = std::atof(argv[++i]);
+        } else if (arg == "--checkpoint-solutions") {
+            checkpoints.flushSolutions = true;
+        } else if (arg == "--restart") {
+            checkpoints.restart = true;
+        } else if (arg == "--dynamic") {
+            dynamicDistribution = true;
+        } else if (arg == "--coordinator" && i + 1 < argc) {
+            coordinatorAddress = argv[++i];
+        } else if (arg == "--worker" && i + 1 < argc) {
+            workerAddress = argv[++i];
+        } else if (arg == "--lease-timeout" && i + 1 < argc) {
+            leases.leaseSeconds = std::atof(argv[++i]);
+        } else if (arg == "--heartbeat-interval" && i + 1 < argc) {
+            leases.heartbeatSeconds = std::atof(argv[++i]);
+        } else if (arg == "--pin" && i + 1 < argc && parsePinMode(argv[i + 1], pinMode)) {
+            ++i;
+        } else if (arg == "--numa-nodes" && i + 1 < argc) {
+            numaNodes = std::atoi(argv[++i]);
+        } else if (arg == "--stream-output") {
+            stream.enabled = true;
+        } else if (arg == "--stream-chunk" && i + 1 < argc) {
+            stream.chunkBoards = std::min(1LL << 20, std::max(1LL, std::atoll(argv[++i])));
+        } else if (arg == "--writer-rank") {
+            stream.enabled = stream.writerRank = true;
+        } else if (arg == "--direct-io") {
+            stream.directIo = true;
+        } else if (arg == "--analytics" && i + 1 < argc) {
+            analyticsPrefix = argv[++i];
+        } else if (arg == "--compress") {
+            compressOutput = true;
+        } else {
+            if (rankId == 0) {
+                std::cerr << "Usage: " << argv[0] << " [--puzzle <file>] [--checkpoint-dir <dir>]"
+                          << " [--checkpoint-interval <seconds>] [--checkpoint-solutions] [--restart]\n"
+                          << "       [--dynamic | --coordinator <addr> | --worker <addr>]"
+                          << " [--lease-timeout <seconds>] [--heartbeat-interval <seconds>]\n"
+                          << "       [--pin none|cores|numa] [--numa-nodes <count>] [--analytics <prefix>]\n"
+                          << "       [--stream-output | --writer-rank] [--stream-chunk <boards>] [--direct-io] [--compress]\n"
+                          << "  <addr> is unix:<path> or <host>:<port>\n";
+            }
+            MPI_Finalize();
+            return 1;
+        }
+    }
+    if (checkpoints.restart && checkpoints.directory.empty()) {
+        if (rankId == 0) std::cerr << "Error: --restart needs --checkpoint-dir\n";
+        MPI_Finalize();
+        return 1;
+    }
+    if (!checkpoints.directory.empty() && (dynamicDistribution || !coordinatorAddress.empty() || !workerAddress.empty())) {
+        if (rankId == 0) std::cerr << "Error: --checkpoint-dir cannot be combined with dynamic or socket distribution\n";
+        MPI_Finalize();
+        return 1;
+    }
+    if (!analyticsPrefix.empty() && (!checkpoints.directory.empty() || dynamicDistribution ||
+                                     !coordinatorAddress.empty() || !workerAddress.empty())) {
+        if (rankId == 0) std::cerr << "Error: --analytics cannot be combined with checkpoints or dynamic distribution\n";
+        MPI_Finalize();
+        return 1;
+    }
+    if (stream.enabled && (!checkpoints.directory.empty() || dynamicDistribution || !coordinatorAddress.empty() ||
+                         !workerAddress.empty() || !analyticsPrefix.empty())) {
+        if (rankId == 0) std::cerr << "Error: --stream-output and --writer-rank only apply to the plain static search\n";
+        MPI_Finalize();
+        return 1;
+    }
+    if (stream.directIo && !stream.enabled) {
+        if (rankId == 0) std::cerr << "Error: --direct-io only applies to --stream-output and --writer-rank\n";
+        MPI_Finalize();
+        return 1;
+    }
+    if (compressOutput && (stream.enabled || dynamicDistribution || !coordinatorAddress.empty() ||
+                           !workerAddress.empty() || !analyticsPrefix.empty())) {
+        if (rankId == 0) std::cerr << "Error: --compress only applies to the gathered static search output\n";
+        MPI_Finalize();
+        return 1;
+    }
+    if (dynamicDistribution && coordinatorAddress.empty() && workerAddress.empty() && totalRanks < 2) {
+        if (rankId == 0) std::cerr << "Error: --dynamic needs at least 2 ranks (rank 0 only coordinates)\n";
+        MPI_Finalize();
+        return 1;
+    }
+    if (stream.writerRank && totalRanks < 2) {
+        if (rankId == 0) std::cerr << "Error: --writer-rank needs at least 2 ranks (rank 0 only writes)\n";
+        MPI_Finalize();
+        return 1;
+    }
+    if (!puzzlePath.empty()) {
+        std::string error;
+        if (!loadPuzzleDefinition(puzzlePath, puzzle, error)) {
+            if (rankId == 0) std::cerr << "Error: " << error << "\n";
+            MPI_Finalize();
+            return 1;
+        }
+    }
+
+    // Pin each rank by its rank on the host before anything large is allocated, so the tables
+    // and solution buffers are first touched on the rank's own NUMA node
+    if (pinMode != PIN_NONE) pinRankAndReport(pinMode, numaNodes, rankId, totalRanks);
+
     double startTime = MPI_Wtime();
-    precomputeAllPiecePlacements();
-
-    int totalStartingPlacements = piecePlacementMasks[0].size();
-    std::vector<BoardRepresentation> localSolutions;
-    BoardRepresentation initialBoard;
-    initialBoard.fill('.');
-    std::array<bool, TOTAL_PIECES> initialUsed;
-    initialUsed.fill(false);
-
-    // Distribute first-piece placements among MPI ranks
-    for (int i = rankId; i < totalStartingPlacements; i += totalRanks) {
-        BoardRepresentation currentBoard = initialBoard;
-        auto used = initialUsed;
-        uint64_t currentMask = piecePlacementMasks[0][i];
-        used[0] = true;
-        for (int cell : piecePlacementCells[0][i]) {
-            currentBoard[cell] = 'A';
+    precomputeAllPiecePlacements(puzzle);
+
+    if (rankId == 0) {
+        std::string mismatch = describePieceAreaMismatch(puzzle);
+        if (!mismatch.empty()) std::cerr << "Warning: " << mismatch << "\n";
+    }
+
+    // Dynamic distribution: leased units, heartbeats and reissue on worker failure
+    if (dynamicDistribution || !coordinatorAddress.empty() || !workerAddress.empty()) {
+        std::vector<UnitLease> units(puzzle.piecePlacementCells[0].size());
+        bool allWorkersFinished = true;
+        if (!workerAddress.empty()) {
+            // Separate worker process; retry while the coordinator is starting up
+            runSocketWorker(puzzle, workerAddress, leases);
+        } else if (!coordinatorAddress.empty()) {
+            if (!runSocketCoordinator(puzzle, coordinatorAddress, leases)) {
+                MPI_Finalize();
+                return 1;
+            }
+            std::cout << "Elapsed time: " << (MPI_Wtime() - startTime) << " seconds\n";
+        } else if (rankId == 0) {
+            MpiCoordinatorTransport transport;
+            std::vector<int> workerRanks;
+            for (int r = 1; r < totalRanks; ++r) workerRanks.push_back(r);
+            allWorkersFinished = runCoordinator(puzzle, transport, leases, workerRanks, units);
+            writeCoordinatorResults(puzzle, units);
+            std::cout << "Elapsed time: " << (MPI_Wtime() - startTime) << " seconds\n";
+        } else {
+            MpiWorkerTransport transport;
+            runWorkerForBoard(puzzle, transport, leases);
+        }
+        // A hung rank would block MPI_Finalize forever; results are already written
+        if (!allWorkersFinished && workerAddress.empty() && coordinatorAddress.empty()) MPI_Abort(MPI_COMM_WORLD, 0);
+        MPI_Finalize();
+        return 0;
+    }
+
+    // Analytics: every rank counts its share, one reduction sums the counters on rank 0
+    if (!analyticsPrefix.empty()) {
+        SolutionAnalytics analytics(puzzle);
+        analyzeAssignedPlacementsForBoard(puzzle, rankId, totalRanks, analytics);
+        std::vector<unsigned long long> &counters = analytics.counters();
+        std::vector<unsigned long long> globalCounters(counters.size());
+        MPI_Reduce(counters.data(), globalCounters.data(), counters.size(), MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+        int exitCode = 0;
+        if (rankId == 0) {
+            counters.swap(globalCounters);
+            std::string error;
+            if (!analytics.writeReports(analyticsPrefix, error)) {
+                std::cerr << "Error: " << error << "\n";
+                exitCode = 1;
+            } else {
+                printSolutionTotals(analytics.solutionCount(), analytics.solutionDigest());
+                std::cout << "Analytics written to " << analyticsPrefix << ".json and " << analyticsPrefix << "_*.csv\n";
+                std::cout << "Elapsed time: " << (MPI_Wtime() - startTime) << " seconds\n";
+            }
         }
-        recursiveSolver(currentMask, used, currentBoard, localSolutions);
+        MPI_Finalize();
+        return exitCode;
+    }
+
+    if (stream.enabled) {
+        searchAndStreamSolutions(puzzle, rankId, totalRanks, stream, startTime);
+        MPI_Finalize();
+        return 0;
+    }
+
+    // Resume from this rank's checkpoint (finished units, totals and flushed boards)
+    RankProgress progress;
+    std::vector<char> localBuffer;
+    if (!checkpoints.directory.empty()) {
+        installPreemptHandlers();
+        prepareRankCheckpoint(puzzle, checkpoints, rankId, totalRanks, progress, localBuffer);
+    }
+
+    // Dispatch to the narrowest mask that holds the board (single word for the 11x5 board)
+    SearchStatus status = searchAssignedPlacementsForBoard(puzzle, rankId, totalRanks, checkpoints, progress, localBuffer);
+    if (status == SEARCH_INVALID_STATE) MPI_Abort(MPI_COMM_WORLD, 1);
+
+    // A preempted rank has saved its exact position; stop everyone without writing output
+    int localPreempted = status == SEARCH_PAUSED ? 1 : 0, anyPreempted = 0;
+    MPI_Allreduce(&localPreempted, &anyPreempted, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    if (anyPreempted) {
+        if (rankId == 0) std::cout << "Preempted: progress saved in " << checkpoints.directory << "; resume with --restart\n";
+        MPI_Finalize();
+        return 0;
     }
 
+    // Totals and digests include boards found before a restart, even if they were not flushed
+    unsigned long long localTotals[2] = { progress.solutionCount, progress.solutionDigest };
+    unsigned long long globalTotals[2] = { 0, 0 };
+    MPI_Reduce(localTotals, globalTotals, 2, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+
     // Collect solution counts
-    int localCount = localSolutions.size();
+    int localCount = localBuffer.size() / puzzle.totalCells;
+
+    // Compressed output: each rank codes its own boards and the blocks are gathered instead
+    if (compressOutput) {
+        std::vector<char> compressed;
+        std::string error;
+        if (!compressSolutions(puzzle, localBuffer.data(), localCount, compressed, error)) {
+            std::cerr << "Error: rank " << rankId << ": " << error << "\n";
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        localBuffer.swap(compressed);
+    }
     std::vector<int> solutionCounts;
     if (rankId == 0) {
         solutionCounts.resize(totalRanks);
@@ -206,12 +491,8 @@ int main(int argc, char **argv) {
     MPI_Gather(&localCount, 1, MPI_INT,
                solutionCounts.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
 
-    // Flatten local solutions to char buffer
-    int localChars = localCount * TOTAL_CELLS;
-    std::vector<char> localBuffer(localChars);
-    for (int i = 0; i < localCount; ++i) {
-        std::memcpy(&localBuffer[i * TOTAL_CELLS], localSolutions[i].data(), TOTAL_CELLS);
-    }
+    // Local solutions are already stored as a flat char buffer (or as compressed blocks)
+    int localChars = localBuffer.size();
 
     // Setup receive buffers on rank 0
     std::vector<int> recvCounts, displacements;
@@ -219,9 +500,11 @@ int main(int argc, char **argv) {
     if (rankId == 0) {
         recvCounts.resize(totalRanks);
         displacements.resize(totalRanks);
+    }
+    MPI_Gather(&localChars, 1, MPI_INT, recvCounts.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (rankId == 0) {
         int offset = 0;
         for (int i = 0; i < totalRanks; ++i) {
-            recvCounts[i] = solutionCounts[i] * TOTAL_CELLS;
             displacements[i] = offset;
             offset += recvCounts[i];
         }
@@ -235,24 +518,28 @@ int main(int argc, char **argv) {
 
     // Output results to file from rank 0
     if (rankId == 0) {
-        std::ofstream outputFile("solutions.txt");
+        const char *outputPath = compressOutput ? "solutions.iqz" : "solutions.txt";
+        std::ofstream outputFile(outputPath, std::ios::binary);
         if (!outputFile.is_open()) {
-            std::cerr << "Error: Could not open solutions.txt\n";
+            std::cerr << "Error: Could not open " << outputPath << "\n";
         } else {
-            int totalSolutions = std::accumulate(solutionCounts.begin(), solutionCounts.end(), 0);
-            for (int r = 0; r < totalRanks; ++r) {
-                int count = solutionCounts[r];
-                for (int s = 0; s < count; ++s) {
-                    const char *boardData = allSolutionsBuffer.data() + displacements[r] + s * TOTAL_CELLS;
-                    for (int row = 0; row < BOARD_HEIGHT; ++row) {
-                        outputFile.write(boardData + row * BOARD_WIDTH, BOARD_WIDTH);
-                        outputFile.put('\n');
-                    }
-                    outputFile.put('\n');
+            long long boardsWritten = std::accumulate(solutionCounts.begin(), solutionCounts.end(), 0LL);
+            if (compressOutput) {
+                std::vector<char> header;
+                appendCompressedHeader(puzzle, header);
+                outputFile.write(header.data(), header.size());
+                outputFile.write(allSolutionsBuffer.data(), allSolutionsBuffer.size());
+            } else {
+                for (int r = 0; r < totalRanks; ++r) {
+                    writeBoardsAsText(outputFile, puzzle, allSolutionsBuffer.data() + displacements[r], solutionCounts[r]);
                 }
             }
             outputFile.close();
-            std::cout << "Total solutions: " << totalSolutions << "\n";
+            if ((unsigned long long)boardsWritten != globalTotals[0]) {
+                std::cerr << "Warning: " << outputPath << " holds " << boardsWritten << " of " << globalTotals[0]
+                          << " solutions (boards found before the restart were not flushed)\n";
+            }
+            printSolutionTotals(globalTotals[0], globalTotals[1]);
         }
         double endTime = MPI_Wtime();
         std::cout << "Elapsed time: " << (endTime - startTime) << " seconds\n";
@@ -0,0 +1,166 @@
+// iqfit_output.cpp
+// Double-buffered block writer for solutions.txt.
+
+#include "iqfit_output.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+constexpr size_t OUTPUT_ALIGNMENT = 4096;
+
+BlockWriter::BlockWriter(const PuzzleTables &puzzle, size_t blockBytes)
+    : puzzle(puzzle), blockBytes((std::max(blockBytes, OUTPUT_ALIGNMENT) + OUTPUT_ALIGNMENT - 1) / OUTPUT_ALIGNMENT * OUTPUT_ALIGNMENT) {
+    boardText.resize(boardTextBytes(puzzle));
+}
+
+BlockWriter::~BlockWriter() {
+    std::string ignored;
+    if (fd >= 0) close(ignored);
+    for (char *block : blocks) std::free(block);
+}
+
+bool BlockWriter::open(const std::string &path, bool useDirectIo, std::string &error) {
+    for (char *&block : blocks) {
+        if (!block && posix_memalign(reinterpret_cast<void **>(&block), OUTPUT_ALIGNMENT, blockBytes) != 0) {
+            block = nullptr;
+            error = "cannot allocate output blocks";
+            return false;
+        }
+    }
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+    directIo = false;
+#ifdef O_DIRECT
+    if (useDirectIo) {
+        fd = ::open(path.c_str(), flags | O_DIRECT, 0644);
+        if (fd >= 0) {
+            directIo = true;
+        } else if (errno == EINVAL) {
+            std::cerr << "Warning: " << path << " does not support O_DIRECT; writing through the page cache\n";
+        }
+    }
+#else
+    if (useDirectIo) std::cerr << "Warning: O_DIRECT is not available; writing through the page cache\n";
+#endif
+    if (fd < 0) fd = ::open(path.c_str(), flags, 0644);
+    if (fd < 0) {
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    fillingBlock = 0;
+    filledBytes = 0;
+    stopping = false;
+    writeError.clear();
+    writer = std::thread(&BlockWriter::writerLoop, this);
+    return true;
+}
+
+void BlockWriter::appendBoards(const char *boards, size_t boardCount) {
+    if (fd < 0) return;
+    const size_t boardBytes = boardText.size();
+    size_t s = 0;
+    while (s < boardCount) {
+        // Whole boards are formatted straight into the block; only a board that straddles two
+        // blocks goes through boardText
+        size_t fitting = std::min(boardCount - s, (blockBytes - filledBytes) / boardBytes);
+        if (fitting > 0) {
+            formatBoardsAsText(puzzle, boards + s * puzzle.totalCells, fitting, blocks[fillingBlock] + filledBytes);
+            filledBytes += fitting * boardBytes;
+            s += fitting;
+            if (filledBytes == blockBytes) submitFullBlock();
+        } else {
+            formatBoardsAsText(puzzle, boards + s * puzzle.totalCells, 1, boardText.data());
+            appendBytes(boardText.data(), boardBytes);
+            ++s;
+        }
+    }
+    boardsAppended += boardCount;
+}
+
+// Boards may straddle two blocks, which keeps every full block exactly blockBytes long
+void BlockWriter::appendBytes(const char *data, size_t length) {
+    while (length > 0) {
+        size_t taken = std::min(length, blockBytes - filledBytes);
+        std::memcpy(blocks[fillingBlock] + filledBytes, data, taken);
+        filledBytes += taken;
+        data += taken;
+        length -= taken;
+        if (filledBytes == blockBytes) submitFullBlock();
+    }
+}
+
+// Wait for the writer to finish the other block, hand it this one and fill the other
+void BlockWriter::submitFullBlock() {
+    std::unique_lock<std::mutex> guard(lock);
+    changed.wait(guard, [&]() { return pendingBlock == nullptr; });
+    pendingBlock = blocks[fillingBlock];
+    pendingBytes = filledBytes;
+    changed.notify_all();
+    fillingBlock = 1 - fillingBlock;
+    filledBytes = 0;
+}
+
+void BlockWriter::writerLoop() {
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        changed.wait(guard, [&]() { return pendingBlock != nullptr || stopping; });
+        if (!pendingBlock) return;
+        const char *data = pendingBlock;
+        size_t remaining = pendingBytes;
+        guard.unlock();
+        while (remaining > 0) {
+            ssize_t written = ::write(fd, data, remaining);
+            if (written < 0 && errno == EINTR) continue;
+            if (written <= 0) {
+                guard.lock();
+                if (writeError.empty()) writeError = std::string("write failed: ") + std::strerror(errno);
+                guard.unlock();
+                break;
+            }
+            data += written;
+            remaining -= written;
+        }
+        guard.lock();
+        pendingBlock = nullptr;
+        changed.notify_all();
+    }
+}
+
+bool BlockWriter::close(std::string &error) {
+    if (fd < 0) return true;
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        changed.wait(guard, [&]() { return pendingBlock == nullptr; });
+        stopping = true;
+        changed.notify_all();
+    }
+    writer.join();
+
+    // The last block is not a whole number of aligned sectors, so it bypasses O_DIRECT
+#ifdef O_DIRECT
+    if (directIo) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+#endif
+    const char *data = blocks[fillingBlock];
+    while (filledBytes > 0 && writeError.empty()) {
+        ssize_t written = ::write(fd, data, filledBytes);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) {
+            writeError = std::string("write failed: ") + std::strerror(errno);
+            break;
+        }
+        data += written;
+        filledBytes -= written;
+    }
+    filledBytes = 0;
+    if (::close(fd) != 0 && writeError.empty()) writeError = std::string("close failed: ") + std::strerror(errno);
+    fd = -1;
+    if (!writeError.empty()) {
+        error = writeError;
+        return false;
+    }
+    return true;
+}
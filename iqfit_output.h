@@ -0,0 +1,60 @@
+// iqfit_output.h
+// solutions.txt output in large sequential writes. Boards are formatted straight into one of
+// two large blocks; when a block is full it is handed to a background thread that writes it
+// with write(2) while the next block fills (double buffering). Every block but the last is
+// exactly blockBytes long and aligned, so the file can optionally be written with O_DIRECT.
+// The text is the same as writeBoardsAsText produces.
+
+#ifndef IQFIT_OUTPUT_H
+#define IQFIT_OUTPUT_H
+
+#include "iqfit_core.h"
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class BlockWriter {
+public:
+    // blockBytes is rounded up to a multiple of 4096
+    explicit BlockWriter(const PuzzleTables &puzzle, size_t blockBytes = 8u << 20);
+    ~BlockWriter();
+
+    // Create (truncate) the file and start the writer thread. With directIo, O_DIRECT is used
+    // where the file system supports it (a warning is printed where it does not).
+    bool open(const std::string &path, bool directIo, std::string &error);
+
+    // Format boards (row-major, totalCells characters each) into the current block
+    void appendBoards(const char *boards, size_t boardCount);
+
+    // Write the last partial block, stop the thread and close the file; false on any write error
+    bool close(std::string &error);
+
+    unsigned long long boardCount() const { return boardsAppended; }
+
+private:
+    void appendBytes(const char *data, size_t length);
+    void submitFullBlock();
+    void writerLoop();
+
+    const PuzzleTables &puzzle;
+    size_t blockBytes;
+    char *blocks[2] = { nullptr, nullptr };
+    int fillingBlock = 0;
+    size_t filledBytes = 0;
+    std::vector<char> boardText;            // a board that straddles two blocks
+    unsigned long long boardsAppended = 0;
+
+    int fd = -1;
+    bool directIo = false;
+    std::thread writer;
+    std::mutex lock;
+    std::condition_variable changed;
+    const char *pendingBlock = nullptr;     // block handed to the writer thread, if any
+    size_t pendingBytes = 0;
+    bool stopping = false;
+    std::string writeError;
+};
+
+#endif // IQFIT_OUTPUT_H
@@ -0,0 +1,120 @@
+// iqfit_profile.cpp
+// Broken-profile DP: sweep order, anchored placements and the threaded frontier step.
+
+#include "iqfit_profile.h"
+
+#include <unordered_map>
+#include <thread>
+#include <algorithm>
+
+// Occupancy of the 64 cells from the sweep position on (bit 0 = the current cell) plus the
+// pieces placed so far
+struct FrontierKey {
+    uint64_t window;
+    uint32_t used;
+    bool operator==(const FrontierKey &other) const { return window == other.window && used == other.used; }
+};
+
+struct FrontierHash {
+    size_t operator()(const FrontierKey &key) const {
+        uint64_t mixed = key.window * 0x9E3779B97F4A7C15ULL ^ (uint64_t(key.used) << 1);
+        return size_t(mixed ^ (mixed >> 29));
+    }
+};
+
+using StateList = std::vector<std::pair<FrontierKey, unsigned long long>>;
+
+// A placement whose first cell in sweep order is the anchor; bits are relative to the anchor
+struct AnchoredPlacement {
+    uint32_t pieceBit;
+    uint64_t bits;
+};
+
+bool countByProfile(const PuzzleTables &puzzle, int threads, ProfileCount &result, std::string &error) {
+    const int width = puzzle.boardWidth, height = puzzle.boardHeight, totalCells = puzzle.totalCells;
+    threads = std::max(1, threads);
+    result = ProfileCount();
+
+    // Sweep along the long side, one short column at a time
+    auto sweepIndex = [&](int cell) {
+        int x = cell % width, y = cell / width;
+        return width >= height ? x * height + y : y * width + x;
+    };
+    std::vector<bool> blocked(totalCells, false);
+    for (int cell : puzzle.blockedCells) blocked[sweepIndex(cell)] = true;
+
+    std::vector<std::vector<AnchoredPlacement>> placementsByAnchor(totalCells);
+    for (int p = 0; p < puzzle.totalPieces; ++p) {
+        for (const std::vector<int> &cells : puzzle.piecePlacementCells[p]) {
+            std::vector<int> order;
+            for (int cell : cells) order.push_back(sweepIndex(cell));
+            int anchor = *std::min_element(order.begin(), order.end());
+            uint64_t bits = 0;
+            for (int index : order) {
+                if (index - anchor >= 64) {
+                    error = "a piece reaches more than 64 cells ahead along the sweep; the board's short side is too wide for the profile count";
+                    return false;
+                }
+                bits |= 1ULL << (index - anchor);
+            }
+            placementsByAnchor[anchor].push_back(AnchoredPlacement{ 1u << p, bits });
+        }
+    }
+
+    StateList current(1, std::make_pair(FrontierKey{ 0, 0 }, 1ULL));
+    std::vector<std::vector<StateList>> emitted(threads, std::vector<StateList>(threads));
+    std::vector<StateList> merged(threads);
+    for (int index = 0; index < totalCells; ++index) {
+        // Expand: thread t takes a slice of the states and sorts what it produces into shards
+        auto expand = [&](int t) {
+            for (StateList &shard : emitted[t]) shard.clear();
+            size_t begin = current.size() * t / threads, end = current.size() * (t + 1) / threads;
+            auto emit = [&](uint64_t window, uint32_t used, unsigned long long count) {
+                FrontierKey key{ window >> 1, used };
+                emitted[t][FrontierHash()(key) % threads].push_back(std::make_pair(key, count));
+            };
+            for (size_t s = begin; s < end; ++s) {
+                const FrontierKey &key = current[s].first;
+                if (blocked[index] || (key.window & 1)) {
+                    emit(key.window, key.used, current[s].second);
+                    continue;
+                }
+                for (const AnchoredPlacement &placement : placementsByAnchor[index]) {
+                    if ((key.used & placement.pieceBit) || (key.window & placement.bits)) continue;
+                    emit(key.window | placement.bits, key.used | placement.pieceBit, current[s].second);
+                }
+            }
+        };
+        // Merge: thread s owns shard s of the next frontier, so no two threads touch one key
+        auto merge = [&](int s) {
+            std::unordered_map<FrontierKey, unsigned long long, FrontierHash> combined;
+            for (int t = 0; t < threads; ++t) {
+                for (const auto &entry : emitted[t][s]) combined[entry.first] += entry.second;
+            }
+            merged[s].assign(combined.begin(), combined.end());
+        };
+        if (threads == 1) {
+            expand(0);
+            merge(0);
+        } else {
+            std::vector<std::thread> workers;
+            for (int t = 0; t < threads; ++t) workers.emplace_back(expand, t);
+            for (auto &worker : workers) worker.join();
+            workers.clear();
+            for (int s = 0; s < threads; ++s) workers.emplace_back(merge, s);
+            for (auto &worker : workers) worker.join();
+        }
+
+        current.clear();
+        for (StateList &shard : merged) current.insert(current.end(), shard.begin(), shard.end());
+        result.peakStates = std::max(result.peakStates, current.size());
+    }
+
+    // Placements never leave the board, so every surviving state has an empty window
+    const uint32_t allPieces = (1u << puzzle.totalPieces) - 1;
+    for (const auto &entry : current) {
+        result.anySubset += entry.second;
+        if (entry.first.used == allPieces) result.allPieces += entry.second;
+    }
+    return true;
+}
@@ -0,0 +1,27 @@
+// iqfit_profile.h
+// Exact solution counts without enumerating solutions: a broken-profile (transfer-matrix)
+// dynamic program that sweeps the board column by column along its long side. A state is the
+// occupancy of the cells ahead of the sweep position (at most 64 of them) plus the set of
+// pieces already used; each step covers the cell at the sweep position with every piece
+// anchored there, so the frontier never holds more than the cells a piece can reach.
+// The cost grows with the short side and the number of distinct frontiers, not with the
+// number of solutions, so long narrow boards (5xN, 11xN) are cheap to count.
+
+#ifndef IQFIT_PROFILE_H
+#define IQFIT_PROFILE_H
+
+#include "iqfit_core.h"
+#include <string>
+
+struct ProfileCount {
+    unsigned long long allPieces = 0;   // tilings that use every piece (the solver's total)
+    unsigned long long anySubset = 0;   // tilings that use each piece at most once
+    size_t peakStates = 0;              // widest frontier, in (occupancy, used pieces) states
+};
+
+// Count the tilings of the puzzle's open cells (placement tables must be precomputed). Each
+// sweep step is split over threads by frontier state. Fails if a placement reaches more than
+// 64 cells ahead of its first cell in sweep order (a board too wide for a one-word frontier).
+bool countByProfile(const PuzzleTables &puzzle, int threads, ProfileCount &result, std::string &error);
+
+#endif // IQFIT_PROFILE_H
@@ -0,0 +1,581 @@
+// iqfit_server.cpp
+// Solve server: keeps one prepared puzzle resident and answers challenge boards sent over a
+// UNIX domain socket or a localhost TCP socket. One I/O thread reads requests from all
+// clients; requests that arrive close together are grouped into a batch and handed to a
+// pool of solver threads, which hand the answers back to the I/O thread. It queues them per
+// client and sends them without blocking, so a client that stops reading only holds up
+// itself. Latency (arrival to answer ready) is reported as p50/p99 every report interval,
+// on the "stats" request and at shutdown.
+//
+// Protocol: one request per line, one answer per request. Boards are partial boards in the
+// library format (row-major, '.' empty, 'A'.. placed pieces, '#' kept empty).
+//   solve <max> <board>   -> "ok <returned> <counted> <complete>" + <returned> board lines
+//                            (max 0 = up to the server's --max-solutions, which also caps max)
+//   count <board>         -> "ok 0 <counted> <complete>"
+//   hint <board>          -> "ok <pieces> <forced> <complete>" + one line per remaining piece:
+//                            "<letter> <live> <cells> <cells> ..." listing each placement that
+//                            appears in a completion as comma-separated cell indices
+//   stats                 -> "ok stats <requests> <p50 ms> <p99 ms>"
+//   invalid request       -> "error <message>"
+// <complete> is 1 when the search was exhausted. A client sends its next request after the
+// previous answer (pipelined lines are queued in order); use several connections for
+// concurrency. A connection reset cancels the running solve, and a solve that runs past
+// --max-request-ms stops with <complete> 0. A client whose unsent answers pass
+// MAX_OUTPUT_BACKLOG when another one is ready is dropped.
+
+#include "iqfit_core.h"
+#include "iqfit_solver.h"
+#include "iqfit_distributed.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <algorithm>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+// Longest request line accepted (a 256-cell board plus the command)
+constexpr size_t MAX_REQUEST_LENGTH = 1024;
+
+// Unsent answer bytes a client may have when the next answer is ready (one full solve
+// answer always fits on top of it)
+constexpr size_t MAX_OUTPUT_BACKLOG = 8u << 20;
+
+static volatile std::sig_atomic_t shutdownRequested = 0;
+
+static void handleShutdownSignal(int) {
+    shutdownRequested = 1;
+}
+
+struct ServerOptions {
+    std::string address;
+    std::string puzzlePath;
+    int threads = 0;                // 0 = one per hardware thread
+    int batchSize = 16;             // dispatch as soon as this many requests are waiting
+    double batchWindowMs = 1.0;     // ... or when the oldest waiting request is this old
+    double reportSeconds = 10.0;
+    long long maxSolutions = 100000; // most boards one solve answer holds (about 6 MB on 11x5)
+    double maxRequestMs = 60000.0;  // time budget of one solve, count or hint (0 = none)
+    bool propagate = false;         // constraint propagation in every solve
+    std::string ordering = "index"; // index, largest, fewest or learned
+    std::string trainingPath;       // challenge file the learned ordering is trained on
+};
+
+// Boards of a challenge file (the last field of each request line), for ordering training
+static bool loadTrainingBoards(const std::string &path, std::vector<std::string> &boards, std::string &error) {
+    std::ifstream input(path);
+    if (!input) {
+        error = "cannot open training file " + path;
+        return false;
+    }
+    std::string line;
+    while (std::getline(input, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        std::string field, board;
+        while (fields >> field) board = field;
+        boards.push_back(board);
+    }
+    return true;
+}
+
+static bool applyOrdering(const ServerOptions &options, PreparedPuzzle &puzzle, std::string &error) {
+    if (options.ordering == "learned") {
+        std::vector<std::string> boards;
+        if (options.trainingPath.empty()) {
+            error = "--ordering learned needs --training <challenge file>";
+            return false;
+        }
+        if (!loadTrainingBoards(options.trainingPath, boards, error)) return false;
+        return learnSearchOrdering(puzzle, boards, 200000, puzzle.searchOptions, error);
+    }
+    if (options.ordering == "index") {
+        applyPieceOrdering(puzzle.tables, ORDER_INDEX, puzzle.searchOptions);
+    } else if (options.ordering == "largest") {
+        applyPieceOrdering(puzzle.tables, ORDER_LARGEST_FIRST, puzzle.searchOptions);
+    } else if (options.ordering == "fewest") {
+        applyPieceOrdering(puzzle.tables, ORDER_FEWEST_PLACEMENTS, puzzle.searchOptions);
+    } else {
+        error = "unknown ordering '" + options.ordering + "'";
+        return false;
+    }
+    return true;
+}
+
+struct ClientConnection {
+    int fd;
+    std::string input;        // received bytes that do not form a full line yet
+    std::string output;       // answers not sent yet, from outputSent on
+    size_t outputSent = 0;
+    bool busy = false;        // a request is queued or being solved; reading pauses meanwhile
+    bool hungUp = false;      // client stopped sending; released once its last answer is sent
+    SolveControl control;     // cancels the running solve when the client goes away
+};
+
+struct PendingRequest {
+    ClientConnection *client;
+    std::string line;
+    double arrivalTime;
+};
+
+// Latencies since the last report, plus running totals
+class LatencyStats {
+public:
+    void record(double milliseconds) {
+        std::lock_guard<std::mutex> guard(lock);
+        intervalMs.push_back(milliseconds);
+        ++totalRequests;
+    }
+
+    void recordBatch(size_t requests) {
+        std::lock_guard<std::mutex> guard(lock);
+        ++totalBatches;
+        batchedRequests += requests;
+    }
+
+    // "<requests> <p50> <p99>" over every request so far (for the stats request)
+    std::string summary() {
+        std::lock_guard<std::mutex> guard(lock);
+        std::vector<double> samples = allMs;
+        samples.insert(samples.end(), intervalMs.begin(), intervalMs.end());
+        char text[96];
+        std::snprintf(text, sizeof(text), "%llu %.3f %.3f", totalRequests,
+                      percentileOf(samples, 0.50), percentileOf(samples, 0.99));
+        return text;
+    }
+
+    // Print the interval's throughput and latency percentiles, then start a new interval
+    void report(double intervalSeconds) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (intervalMs.empty()) return;
+        std::vector<double> samples = intervalMs;
+        double p50 = percentileOf(samples, 0.50), p99 = percentileOf(samples, 0.99);
+        double maxMs = *std::max_element(samples.begin(), samples.end());
+        std::printf("Served %zu requests (%.1f/s, %llu total): p50 %.3f ms, p99 %.3f ms, max %.3f ms, mean batch %.1f\n",
+                    intervalMs.size(), intervalMs.size() / std::max(intervalSeconds, 1e-9), totalRequests,
+                    p50, p99, maxMs, totalBatches ? (double)batchedRequests / totalBatches : 0.0);
+        std::fflush(stdout);
+        allMs.insert(allMs.end(), intervalMs.begin(), intervalMs.end());
+        intervalMs.clear();
+    }
+
+private:
+    std::mutex lock;
+    std::vector<double> intervalMs;
+    std::vector<double> allMs;
+    unsigned long long totalRequests = 0;
+    unsigned long long totalBatches = 0;
+    unsigned long long batchedRequests = 0;
+};
+
+// Batches waiting for a solver thread
+class BatchQueue {
+public:
+    void push(std::vector<PendingRequest> batch) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            batches.push_back(std::move(batch));
+        }
+        ready.notify_one();
+    }
+
+    // Wait for the next batch; false once the queue is closed and empty
+    bool pop(std::vector<PendingRequest> &batch) {
+        std::unique_lock<std::mutex> guard(lock);
+        ready.wait(guard, [this]() { return closed || !batches.empty(); });
+        if (batches.empty()) return false;
+        batch = std::move(batches.front());
+        batches.pop_front();
+        return true;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            closed = true;
+        }
+        ready.notify_all();
+    }
+
+private:
+    std::mutex lock;
+    std::condition_variable ready;
+    std::deque<std::vector<PendingRequest>> batches;
+    bool closed = false;
+};
+
+struct Completion {
+    ClientConnection *client;
+    std::string answer;
+};
+
+// Answered requests, handed back to the I/O thread
+class CompletionList {
+public:
+    CompletionList() {
+        // Non-blocking both ways: draining never waits and a full pipe never stalls a solver
+        if (pipe(wakeFds) != 0) wakeFds[0] = wakeFds[1] = -1;
+        fcntl(wakeFds[0], F_SETFL, O_NONBLOCK);
+        fcntl(wakeFds[1], F_SETFL, O_NONBLOCK);
+    }
+
+    ~CompletionList() {
+        close(wakeFds[0]);
+        close(wakeFds[1]);
+    }
+
+    void add(ClientConnection *client, std::string answer) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            finished.push_back(Completion{ client, std::move(answer) });
+        }
+        char wake = 1;
+        ssize_t ignored = write(wakeFds[1], &wake, 1);
+        (void)ignored;
+    }
+
+    std::vector<Completion> take() {
+        char drain[64];
+        while (read(wakeFds[0], drain, sizeof(drain)) == (ssize_t)sizeof(drain)) {}
+        std::lock_guard<std::mutex> guard(lock);
+        std::vector<Completion> taken;
+        taken.swap(finished);
+        return taken;
+    }
+
+    int wakeFd() const { return wakeFds[0]; }
+
+private:
+    std::mutex lock;
+    std::vector<Completion> finished;
+    int wakeFds[2];
+};
+
+// Send as much queued output as the socket takes without blocking; false if the connection failed
+static bool flushOutput(ClientConnection &client) {
+    while (client.outputSent < client.output.size()) {
+        ssize_t sent = send(client.fd, client.output.data() + client.outputSent,
+                            client.output.size() - client.outputSent, MSG_NOSIGNAL);
+        if (sent > 0) {
+            client.outputSent += sent;
+        } else if (sent < 0 && errno == EINTR) {
+            continue;
+        } else {
+            return sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        }
+    }
+    client.output.clear();
+    client.outputSent = 0;
+    return true;
+}
+
+// Queue an answer and start sending it; false if the client must be dropped (its backlog
+// is over MAX_OUTPUT_BACKLOG or the connection failed)
+static bool queueOutput(ClientConnection &client, const std::string &answer) {
+    if (client.output.size() - client.outputSent > MAX_OUTPUT_BACKLOG) return false;
+    client.output.erase(0, client.outputSent);
+    client.outputSent = 0;
+    client.output += answer;
+    return flushOutput(client);
+}
+
+static std::string answerHint(const PreparedPuzzle &puzzle, ClientConnection &client, const std::string &board) {
+    HintResult hint;
+    std::string error;
+    if (!hintPartialBoard(puzzle, board, &client.control, hint, error)) return "error " + error + "\n";
+    const PuzzleTables &tables = puzzle.tables;
+    std::ostringstream pieces;
+    int pieceLines = 0;
+    for (int pieceIdx = 0; pieceIdx < tables.totalPieces; ++pieceIdx) {
+        if (board.find(char('A' + pieceIdx)) != std::string::npos) continue;    // already placed
+        pieces << char('A' + pieceIdx) << " " << hint.livePlacements[pieceIdx].size();
+        for (int placementIdx : hint.livePlacements[pieceIdx]) {
+            std::vector<int> cells = tables.piecePlacementCells[pieceIdx][placementIdx];
+            std::sort(cells.begin(), cells.end());
+            for (size_t c = 0; c < cells.size(); ++c) pieces << (c ? "," : " ") << cells[c];
+        }
+        pieces << "\n";
+        ++pieceLines;
+    }
+    std::ostringstream header;
+    header << "ok " << pieceLines << " " << hint.forcedPlacements.size() << " " << (hint.stopped ? 0 : 1) << "\n";
+    return header.str() + pieces.str();
+}
+
+// Answer one request line
+static std::string answerRequest(const PreparedPuzzle &puzzle, long long solutionLimit, ClientConnection &client,
+                                 const std::string &line) {
+    std::istringstream fields(line);
+    std::string command, board;
+    long long maxSolutions = 0;
+    fields >> command;
+    if (command == "solve") {
+        if (!(fields >> maxSolutions >> board) || maxSolutions < 0) return "error expected 'solve <max> <board>'\n";
+    } else if (command == "count") {
+        if (!(fields >> board)) return "error expected 'count <board>'\n";
+    } else if (command == "hint") {
+        if (!(fields >> board)) return "error expected 'hint <board>'\n";
+        return answerHint(puzzle, client, board);
+    } else {
+        return "error unknown command '" + command + "'\n";
+    }
+
+    std::string boards;
+    long long returned = 0;
+    SolutionCallback onSolution;
+    if (command == "solve") {
+        onSolution = [&](const char *solution) {
+            boards.append(solution, puzzle.tables.totalCells);
+            boards.push_back('\n');
+            return ++returned < maxSolutions;
+        };
+        // The answer is built in memory, so the server bounds it whatever the client asks for
+        if (maxSolutions == 0 || maxSolutions > solutionLimit) maxSolutions = solutionLimit;
+    }
+    SolveResult result;
+    std::string error;
+    if (!solvePartialBoard(puzzle, board, onSolution, &client.control, result, error)) return "error " + error + "\n";
+    std::ostringstream header;
+    header << "ok " << (command == "solve" ? returned : 0) << " " << result.solutionCount << " " << (result.stopped ? 0 : 1) << "\n";
+    return header.str() + boards;
+}
+
+static void runSolverThread(const PreparedPuzzle &puzzle, long long solutionLimit, double maxRequestMs,
+                            BatchQueue &queue, CompletionList &completions, LatencyStats &stats) {
+    std::vector<PendingRequest> batch;
+    while (queue.pop(batch)) {
+        for (PendingRequest &request : batch) {
+            // The budget starts when the solve does, not when the request arrived
+            request.client->control.deadline = maxRequestMs > 0 ? wallClockSeconds() + maxRequestMs / 1000.0 : 0.0;
+            std::string answer = answerRequest(puzzle, solutionLimit, *request.client, request.line);
+            stats.record((wallClockSeconds() - request.arrivalTime) * 1000.0);
+            completions.add(request.client, std::move(answer));
+        }
+    }
+}
+
+// Split the waiting requests over the solver threads; one queue operation per chunk
+static void dispatchBatch(std::vector<PendingRequest> &waiting, int threads, BatchQueue &queue, LatencyStats &stats) {
+    if (waiting.empty()) return;
+    stats.recordBatch(waiting.size());
+    size_t chunkSize = (waiting.size() + threads - 1) / threads;
+    for (size_t first = 0; first < waiting.size(); first += chunkSize) {
+        size_t last = std::min(waiting.size(), first + chunkSize);
+        queue.push(std::vector<PendingRequest>(waiting.begin() + first, waiting.begin() + last));
+    }
+    waiting.clear();
+}
+
+static int runServer(const ServerOptions &options, const PreparedPuzzle &puzzle) {
+    std::string error;
+    int listenFd = openSocket(options.address, true, error);
+    if (listenFd < 0) {
+        std::cerr << "Error: " << error << "\n";
+        return 1;
+    }
+    int threads = options.threads > 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+
+    BatchQueue queue;
+    CompletionList completions;
+    LatencyStats stats;
+    std::vector<std::thread> solvers;
+    for (int t = 0; t < threads; ++t) {
+        solvers.emplace_back(runSolverThread, std::cref(puzzle), options.maxSolutions, options.maxRequestMs,
+                             std::ref(queue), std::ref(completions), std::ref(stats));
+    }
+    std::cout << "Serving " << puzzle.tables.boardWidth << "x" << puzzle.tables.boardHeight << " puzzle on "
+              << options.address << " with " << threads << " solver threads\n";
+    std::cout.flush();
+
+    std::map<int, std::unique_ptr<ClientConnection>> clients;
+    std::vector<PendingRequest> waiting;
+    double batchStart = 0.0, lastReport = wallClockSeconds();
+
+    auto release = [&](ClientConnection *client) {
+        close(client->fd);
+        clients.erase(client->fd);
+    };
+
+    // A client that stopped sending is released once it has no request or output left
+    auto finished = [](const ClientConnection *client) {
+        return client->hungUp && !client->busy && client->output.empty();
+    };
+
+    // Queue the next complete line of a client (one request at a time per connection);
+    // false if the client sent an over-long line or must be dropped for its output
+    auto takeRequest = [&](ClientConnection *client) {
+        size_t newline;
+        while (!client->busy && (newline = client->input.find('\n')) != std::string::npos) {
+            std::string line = client->input.substr(0, newline);
+            client->input.erase(0, newline + 1);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+            if (line == "stats") {
+                if (!queueOutput(*client, "ok stats " + stats.summary() + "\n")) return false;
+                continue;
+            }
+            if (waiting.empty()) batchStart = wallClockSeconds();
+            client->busy = true;
+            client->control.cancelRequested = false;
+            waiting.push_back(PendingRequest{ client, line, wallClockSeconds() });
+        }
+        if (client->busy || client->input.size() <= MAX_REQUEST_LENGTH) return true;
+        queueOutput(*client, "error request too long\n");
+        return false;
+    };
+
+    while (!shutdownRequested) {
+        // Answered requests: queue the answer and resume reading from the client, or drop it
+        for (Completion &done : completions.take()) {
+            ClientConnection *client = done.client;
+            client->busy = false;
+            if (!queueOutput(*client, done.answer) || !takeRequest(client) || finished(client)) release(client);
+        }
+
+        std::vector<pollfd> watched;
+        watched.push_back(pollfd{ listenFd, POLLIN, 0 });
+        watched.push_back(pollfd{ completions.wakeFd(), POLLIN, 0 });
+        for (auto &entry : clients) {
+            const ClientConnection &client = *entry.second;
+            short events = client.output.empty() ? 0 : POLLOUT;
+            if (!client.hungUp) events |= client.busy ? POLLRDHUP : (POLLIN | POLLRDHUP);
+            if (events) watched.push_back(pollfd{ entry.first, events, 0 });
+        }
+
+        double now = wallClockSeconds();
+        // Wake at least every 200 ms: a shutdown signal may land on a solver thread instead
+        double waitMs = std::min(200.0, options.reportSeconds * 1000.0 - (now - lastReport) * 1000.0);
+        if (!waiting.empty()) waitMs = std::min(waitMs, options.batchWindowMs - (now - batchStart) * 1000.0);
+        int ready = poll(watched.data(), watched.size(), std::max(0, (int)waitMs));
+        if (ready < 0 && errno != EINTR) break;
+
+        for (size_t i = 2; ready > 0 && i < watched.size(); ++i) {
+            if (!watched[i].revents) continue;
+            ClientConnection *client = clients[watched[i].fd].get();
+            bool closing = (watched[i].revents & (POLLRDHUP | POLLHUP | POLLERR)) != 0;
+            bool reset = (watched[i].revents & (POLLHUP | POLLERR)) != 0;
+            if ((watched[i].revents & POLLOUT) && !flushOutput(*client)) closing = reset = true;
+            if (!client->busy && !client->hungUp && (watched[i].revents & POLLIN)) {
+                char buffer[4096];
+                ssize_t received = recv(client->fd, buffer, sizeof(buffer), 0);
+                if (received > 0) client->input.append(buffer, received);
+                if (received == 0 || (received < 0 && errno != EAGAIN && errno != EINTR)) closing = true;
+                if (!takeRequest(client)) closing = reset = true;
+            }
+            if (closing) {
+                // Answer the last request and send the queued output, then release; a reset
+                // connection cannot take either
+                client->hungUp = true;
+                if (reset) {
+                    client->control.cancel();
+                    client->output.clear();
+                    client->outputSent = 0;
+                }
+            }
+            if (finished(client)) release(client);
+        }
+
+        if (watched[0].revents & POLLIN) {
+            int fd = accept(listenFd, nullptr, nullptr);
+            if (fd >= 0) {
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                std::unique_ptr<ClientConnection> client(new ClientConnection());
+                client->fd = fd;
+                clients[fd] = std::move(client);
+            }
+        }
+
+        now = wallClockSeconds();
+        if (!waiting.empty() && ((int)waiting.size() >= options.batchSize || (now - batchStart) * 1000.0 >= options.batchWindowMs)) {
+            dispatchBatch(waiting, threads, queue, stats);
+        }
+        if (now - lastReport >= options.reportSeconds) {
+            stats.report(now - lastReport);
+            lastReport = now;
+        }
+    }
+
+    // Stop: cancel running solves, answer nothing further, and report the last interval
+    for (auto &entry : clients) entry.second->control.cancel();
+    queue.close();
+    for (auto &solver : solvers) solver.join();
+    stats.report(wallClockSeconds() - lastReport);
+    std::cout << "Final: " << stats.summary() << " (requests, p50 ms, p99 ms)\n";
+    for (auto &entry : clients) close(entry.first);
+    close(listenFd);
+    if (options.address.compare(0, 5, "unix:") == 0) unlink(options.address.substr(5).c_str());
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    ServerOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--listen" && i + 1 < argc) {
+            options.address = argv[++i];
+        } else if (arg == "--puzzle" && i + 1 < argc) {
+            options.puzzlePath = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            options.threads = std::atoi(argv[++i]);
+        } else if (arg == "--batch-size" && i + 1 < argc) {
+            options.batchSize = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--batch-window-ms" && i + 1 < argc) {
+            options.batchWindowMs = std::atof(argv[++i]);
+        } else if (arg == "--report-interval" && i + 1 < argc) {
+            options.reportSeconds = std::max(0.1, std::atof(argv[++i]));
+        } else if (arg == "--max-solutions" && i + 1 < argc) {
+            options.maxSolutions = std::max(1LL, std::atoll(argv[++i]));
+        } else if (arg == "--max-request-ms" && i + 1 < argc) {
+            options.maxRequestMs = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "--propagate") {
+            options.propagate = true;
+        } else if (arg == "--ordering" && i + 1 < argc) {
+            options.ordering = argv[++i];
+        } else if (arg == "--training" && i + 1 < argc) {
+            options.trainingPath = argv[++i];
+        } else {
+            options.address.clear();
+            break;
+        }
+    }
+    if (options.address.empty()) {
+        std::cerr << "Usage: " << argv[0] << " --listen <addr> [--puzzle <file>] [--threads <count>]"
+                  << " [--batch-size <requests>] [--batch-window-ms <ms>] [--report-interval <seconds>] [--propagate]\n"
+                  << "  [--max-solutions <boards>] [--max-request-ms <ms>] [--ordering index|largest|fewest|learned] [--training <challenge file>]\n"
+                  << "  <addr> is unix:<path> or <host>:<port> (:<port> listens on loopback only)\n";
+        return 1;
+    }
+
+    PreparedPuzzle puzzle;
+    std::string error;
+    bool prepared = options.puzzlePath.empty() ? preparePuzzle("", puzzle, error)
+                                               : preparePuzzleFile(options.puzzlePath, puzzle, error);
+    if (!prepared) {
+        std::cerr << "Error: " << error << "\n";
+        return 1;
+    }
+
+    puzzle.searchOptions.propagate = options.propagate;
+    if (!applyOrdering(options, puzzle, error)) {
+        std::cerr << "Error: " << error << "\n";
+        return 1;
+    }
+
+    std::signal(SIGINT, handleShutdownSignal);
+    std::signal(SIGTERM, handleShutdownSignal);
+    std::signal(SIGPIPE, SIG_IGN);
+    return runServer(options, puzzle);
+}
@@ -0,0 +1,525 @@
+// iqfit_solver.cpp
+// Library entry points: puzzle preparation and partial-board solves on shared tables.
+
+#include "iqfit_solver.h"
+
+#include <sstream>
+
+// Solves check for cancellation between slices of this many nodes
+static const long long nodesPerSolveSlice = 1LL << 16;
+
+static void buildMaskSet(PreparedPuzzle &prepared) {
+    PlacementMaskSet &masks = prepared.masks;
+    switch ((prepared.tables.totalCells + 63) / 64) {
+        case 1: masks.singleWord = buildPlacementMasks<uint64_t>(prepared.tables); break;
+        case 2: masks.twoWords = buildPlacementMasks<MultiWordMask<2>>(prepared.tables); break;
+        case 3: masks.threeWords = buildPlacementMasks<MultiWordMask<3>>(prepared.tables); break;
+        default: masks.fourWords = buildPlacementMasks<MultiWordMask<4>>(prepared.tables); break;
+    }
+}
+
+bool preparePuzzle(const std::string &definition, PreparedPuzzle &prepared, std::string &error) {
+    PreparedPuzzle built;
+    if (!definition.empty()) {
+        std::istringstream input(definition);
+        if (!parsePuzzleDefinition(input, "definition", built.tables, error)) return false;
+    }
+    precomputeAllPiecePlacements(built.tables);
+    buildMaskSet(built);
+    prepared = std::move(built);
+    return true;
+}
+
+bool preparePuzzleFile(const std::string &path, PreparedPuzzle &prepared, std::string &error) {
+    PreparedPuzzle built;
+    if (!loadPuzzleDefinition(path, built.tables, error)) return false;
+    precomputeAllPiecePlacements(built.tables);
+    buildMaskSet(built);
+    prepared = std::move(built);
+    return true;
+}
+
+// Turn the text of a partial board into a full starting board (blocked cells included).
+// Each piece on the board must cover exactly the cells of one of its placements, so the
+// search never sees a shape it could not have produced itself.
+static bool buildStartBoard(const PuzzleTables &puzzle, const std::string &partialBoard,
+                            BoardRepresentation &startBoard, std::string &error) {
+    startBoard.assign(puzzle.totalCells, '.');
+    for (int cell : puzzle.blockedCells) startBoard[cell] = '#';
+    std::string cells;
+    for (char c : partialBoard) {
+        if (c != ' ' && c != '\n' && c != '\r' && c != '\t') cells.push_back(c);
+    }
+    if (cells.empty()) return true;
+    if ((int)cells.size() != puzzle.totalCells) {
+        error = "partial board has " + std::to_string(cells.size()) + " cells, expected " + std::to_string(puzzle.totalCells);
+        return false;
+    }
+
+    std::vector<std::vector<int>> pieceCells(puzzle.totalPieces);
+    for (int cell = 0; cell < puzzle.totalCells; ++cell) {
+        char c = cells[cell];
+        if (c == '.') continue;
+        if (c == '#') {
+            startBoard[cell] = '#';
+            continue;
+        }
+        int pieceIdx = c - 'A';
+        if (pieceIdx < 0 || pieceIdx >= puzzle.totalPieces) {
+            error = std::string("unknown piece '") + c + "' on the partial board";
+            return false;
+        }
+        if (startBoard[cell] == '#') {
+            error = std::string("piece '") + c + "' covers a blocked cell";
+            return false;
+        }
+        pieceCells[pieceIdx].push_back(cell);
+    }
+
+    for (int pieceIdx = 0; pieceIdx < puzzle.totalPieces; ++pieceIdx) {
+        if (pieceCells[pieceIdx].empty()) continue;
+        bool matched = false;
+        for (const auto &placement : puzzle.piecePlacementCells[pieceIdx]) {
+            std::vector<int> sortedCells = placement;
+            std::sort(sortedCells.begin(), sortedCells.end());
+            if (sortedCells == pieceCells[pieceIdx]) {
+                matched = true;
+                break;
+            }
+        }
+        if (!matched) {
+            error = std::string("piece '") + char('A' + pieceIdx) + "' does not match any of its placements";
+            return false;
+        }
+        for (int cell : pieceCells[pieceIdx]) startBoard[cell] = char('A' + pieceIdx);
+    }
+    return true;
+}
+
+// Search start for a validated starting board: every filled cell is occupied and every
+// piece letter on it is already used
+template <typename BoardMask>
+static SearchStart<BoardMask> startFromBoard(const PuzzleTables &puzzle, const BoardRepresentation &startBoard) {
+    SearchStart<BoardMask> start;
+    start.board = startBoard;
+    start.usedPieces.fill(false);
+    for (int cell = 0; cell < puzzle.totalCells; ++cell) {
+        if (startBoard[cell] == '.') continue;
+        occupyCell(start.mask, cell);
+        if (startBoard[cell] != '#') start.usedPieces[startBoard[cell] - 'A'] = true;
+    }
+    return start;
+}
+
+// Solutions go straight from the search to the callback; nothing is buffered, so the
+// first board is delivered as soon as it is found
+template <typename BoardMask>
+static bool solveWithMask(const PreparedPuzzle &prepared, const BoardRepresentation &startBoard,
+                          const SolutionCallback &onSolution, SolveControl *control,
+                          SolveResult &result, std::string &error) {
+    const PuzzleTables &puzzle = prepared.tables;
+    SearchStart<BoardMask> start = startFromBoard<BoardMask>(puzzle, startBoard);
+    const auto &placementMasks = prepared.masks.get((const BoardMask *)nullptr);
+
+    auto visitSolution = [&](const char *board) {
+        ++result.solutionCount;
+        result.solutionDigest += fnv1aHash(board, puzzle.totalCells);
+        if (onSolution && !onSolution(board)) {
+            result.stopped = true;
+            return false;
+        }
+        return true;
+    };
+
+    SearchState state;
+    SearchStatus status;
+    do {
+        status = resumeSearch(puzzle, placementMasks, start, state, nodesPerSolveSlice, visitSolution, prepared.searchOptions);
+        if (status == SEARCH_INVALID_STATE) {
+            error = "internal error: invalid search state";
+            return false;
+        }
+        if (result.stopped) return true;
+        if (status == SEARCH_PAUSED && control && control->stopRequested()) {
+            result.stopped = true;
+            return true;
+        }
+    } while (status == SEARCH_PAUSED);
+    return true;
+}
+
+bool solvePartialBoard(const PreparedPuzzle &prepared, const std::string &partialBoard,
+                       const SolutionCallback &onSolution, SolveControl *control,
+                       SolveResult &result, std::string &error) {
+    result = SolveResult();
+    if (prepared.tables.piecePlacementCells.empty()) {
+        error = "puzzle has not been prepared";
+        return false;
+    }
+    BoardRepresentation startBoard;
+    if (!buildStartBoard(prepared.tables, partialBoard, startBoard, error)) return false;
+    switch ((prepared.tables.totalCells + 63) / 64) {
+        case 1: return solveWithMask<uint64_t>(prepared, startBoard, onSolution, control, result, error);
+        case 2: return solveWithMask<MultiWordMask<2>>(prepared, startBoard, onSolution, control, result, error);
+        case 3: return solveWithMask<MultiWordMask<3>>(prepared, startBoard, onSolution, control, result, error);
+        default: return solveWithMask<MultiWordMask<4>>(prepared, startBoard, onSolution, control, result, error);
+    }
+}
+
+bool countSolutions(const PreparedPuzzle &prepared, const std::string &partialBoard,
+                    SolveControl *control, SolveResult &result, std::string &error) {
+    return solvePartialBoard(prepared, partialBoard, SolutionCallback(), control, result, error);
+}
+
+// Search behind hintPartialBoard: one depth-first pass that marks every placement of each
+// completion it reaches in a "seen" bitmap. Unseen candidates are tried first so the bitmap
+// fills up early. Once the placements on the current path are all seen, the subtree below
+// only matters if some unseen placement still fits on the board; when none does, it is
+// skipped, which cuts most of the tree on boards with many completions.
+template <typename BoardMask>
+class HintSearch {
+public:
+    HintSearch(const PuzzleTables &puzzle, const std::vector<std::vector<BoardMask>> &placementMasks,
+               const SearchOptions &options, SolveControl *control)
+        : puzzle(puzzle), placementMasks(placementMasks), options(options), control(control) {
+        int totalPlacements = 0;
+        for (int pieceIdx = 0; pieceIdx < puzzle.totalPieces; ++pieceIdx) {
+            placementOffset.push_back(totalPlacements);
+            totalPlacements += placementMasks[pieceIdx].size();
+        }
+        seen.assign(totalPlacements, 0);
+
+        // One candidate list per depth, each as long as the most placements any cell has
+        size_t mostAtCell = 0;
+        for (int cell = 0; cell < puzzle.totalCells; ++cell) {
+            size_t atCell = 0;
+            for (int pieceIdx = 0; pieceIdx < puzzle.totalPieces; ++pieceIdx) {
+                atCell += puzzle.piecePlacementsByCell[pieceIdx][cell].size();
+            }
+            mostAtCell = std::max(mostAtCell, atCell);
+        }
+        candidatesAtDepth.resize(puzzle.totalPieces);
+        for (auto &candidates : candidatesAtDepth) candidates.reserve(mostAtCell);
+    }
+
+    void run(const BoardMask &startMask, uint32_t usedBits, int remaining) {
+        for (int pieceIdx = 0; pieceIdx < puzzle.totalPieces; ++pieceIdx) {
+            usedPieces[pieceIdx] = (usedBits & (1u << pieceIdx)) != 0;
+            if (usedPieces[pieceIdx]) continue;
+            for (int placementIdx = 0; placementIdx < (int)placementMasks[pieceIdx].size(); ++placementIdx) {
+                if (!masksOverlap(placementMasks[pieceIdx][placementIdx], startMask)) {
+                    unseen.push_back(Candidate{ pieceIdx, placementIdx });
+                }
+            }
+        }
+        search(startMask, usedBits, remaining, 0);
+    }
+
+    bool isSeen(int pieceIdx, int placementIdx) const { return seen[placementOffset[pieceIdx] + placementIdx] != 0; }
+
+    bool solvable = false;
+    bool cancelled = false;
+
+private:
+    struct Candidate {
+        int pieceIdx;
+        int placementIdx;
+    };
+
+    // True if an unseen placement of a piece still to place fits around the mask
+    bool unseenPlacementFits(const BoardMask &mask, uint32_t usedBits) {
+        if (unseenStale) {
+            size_t kept = 0;
+            for (const Candidate &candidate : unseen) {
+                if (!isSeen(candidate.pieceIdx, candidate.placementIdx)) unseen[kept++] = candidate;
+            }
+            unseen.resize(kept);
+            unseenStale = false;
+        }
+        for (const Candidate &candidate : unseen) {
+            if (usedBits & (1u << candidate.pieceIdx)) continue;
+            if (!masksOverlap(placementMasks[candidate.pieceIdx][candidate.placementIdx], mask)) return true;
+        }
+        return false;
+    }
+
+    bool pathSeen(int depth) const {
+        if (!solvable) return false;
+        for (int d = 0; d < depth; ++d) {
+            if (!isSeen(path[d].pieceIdx, path[d].placementIdx)) return false;
+        }
+        return true;
+    }
+
+    void search(const BoardMask &mask, uint32_t usedBits, int remaining, int depth) {
+        if ((++nodes & (nodesPerSolveSlice - 1)) == 0 && control && control->stopRequested()) cancelled = true;
+        if (cancelled) return;
+        int cell = chooseBranchCell(puzzle, placementMasks, mask, usedPieces, options);
+        if (cell < 0) return;
+        if (cell >= puzzle.totalCells || remaining == 0) {
+            if (cell < puzzle.totalCells || remaining != 0) return;
+            for (int d = 0; d < depth; ++d) {
+                char &mark = seen[placementOffset[path[d].pieceIdx] + path[d].placementIdx];
+                if (!mark) unseenStale = true;
+                mark = 1;
+            }
+            solvable = true;
+            return;
+        }
+        if (pathSeen(depth) && !unseenPlacementFits(mask, usedBits)) return;
+
+        // Candidates for the cell, unseen ones first
+        std::vector<Candidate> &candidates = candidatesAtDepth[depth];
+        candidates.clear();
+        size_t unseenCount = 0;
+        for (int pieceIdx = 0; pieceIdx < puzzle.totalPieces; ++pieceIdx) {
+            if (usedBits & (1u << pieceIdx)) continue;
+            for (int placementIdx : puzzle.piecePlacementsByCell[pieceIdx][cell]) {
+                if (masksOverlap(placementMasks[pieceIdx][placementIdx], mask)) continue;
+                candidates.push_back(Candidate{ pieceIdx, placementIdx });
+                if (!isSeen(pieceIdx, placementIdx)) std::swap(candidates.back(), candidates[unseenCount++]);
+            }
+        }
+        for (const Candidate &candidate : candidates) {
+            path[depth] = candidate;
+            usedPieces[candidate.pieceIdx] = true;
+            search(mask | placementMasks[candidate.pieceIdx][candidate.placementIdx],
+                   usedBits | (1u << candidate.pieceIdx), remaining - 1, depth + 1);
+            usedPieces[candidate.pieceIdx] = false;
+            if (cancelled) return;
+        }
+    }
+
+    const PuzzleTables &puzzle;
+    const std::vector<std::vector<BoardMask>> &placementMasks;
+    const SearchOptions &options;
+    SolveControl *control;
+    std::array<bool, MAX_PIECES> usedPieces{};
+    std::vector<int> placementOffset;    // index of each piece's first placement in seen
+    std::vector<char> seen;
+    std::array<Candidate, MAX_PIECES> path;
+    std::vector<std::vector<Candidate>> candidatesAtDepth;  // branch candidates of each depth
+    std::vector<Candidate> unseen;       // fitting placements not seen yet (compacted lazily)
+    bool unseenStale = false;
+    long long nodes = 0;
+};
+
+template <typename BoardMask>
+static void hintWithMask(const PreparedPuzzle &prepared, const BoardRepresentation &startBoard,
+                         SolveControl *control, HintResult &result) {
+    const PuzzleTables &puzzle = prepared.tables;
+    SearchStart<BoardMask> start = startFromBoard<BoardMask>(puzzle, startBoard);
+    const auto &placementMasks = prepared.masks.get((const BoardMask *)nullptr);
+
+    uint32_t usedBits = 0;
+    int remaining = 0;
+    for (int pieceIdx = 0; pieceIdx < puzzle.totalPieces; ++pieceIdx) {
+        if (start.usedPieces[pieceIdx]) {
+            usedBits |= 1u << pieceIdx;
+        } else {
+            ++remaining;
+        }
+    }
+
+    result.forcedBoard.assign(startBoard.begin(), startBoard.end());
+    result.livePlacements.assign(puzzle.totalPieces, std::vector<int>());
+    HintSearch<BoardMask> search(puzzle, placementMasks, prepared.searchOptions, control);
+    search.run(start.mask, usedBits, remaining);
+    if (search.cancelled) {
+        result.stopped = true;
+        return;
+    }
+    result.solvable = search.solvable;
+    if (!result.solvable) return;
+
+    for (int pieceIdx = 0; pieceIdx < puzzle.totalPieces; ++pieceIdx) {
+        if (usedBits & (1u << pieceIdx)) continue;
+        for (int placementIdx = 0; placementIdx < (int)puzzle.piecePlacementCells[pieceIdx].size(); ++placementIdx) {
+            if (search.isSeen(pieceIdx, placementIdx)) result.livePlacements[pieceIdx].push_back(placementIdx);
+        }
+        if (result.livePlacements[pieceIdx].size() != 1) continue;
+        int placementIdx = result.livePlacements[pieceIdx][0];
+        result.forcedPlacements.push_back(std::make_pair(pieceIdx, placementIdx));
+        for (int cell : puzzle.piecePlacementCells[pieceIdx][placementIdx]) result.forcedBoard[cell] = char('A' + pieceIdx);
+    }
+}
+
+bool hintPartialBoard(const PreparedPuzzle &prepared, const std::string &partialBoard,
+                      SolveControl *control, HintResult &result, std::string &error) {
+    result = HintResult();
+    if (prepared.tables.piecePlacementCells.empty()) {
+        error = "puzzle has not been prepared";
+        return false;
+    }
+    BoardRepresentation startBoard;
+    if (!buildStartBoard(prepared.tables, partialBoard, startBoard, error)) return false;
+    switch ((prepared.tables.totalCells + 63) / 64) {
+        case 1: hintWithMask<uint64_t>(prepared, startBoard, control, result); break;
+        case 2: hintWithMask<MultiWordMask<2>>(prepared, startBoard, control, result); break;
+        case 3: hintWithMask<MultiWordMask<3>>(prepared, startBoard, control, result); break;
+        default: hintWithMask<MultiWordMask<4>>(prepared, startBoard, control, result); break;
+    }
+    return true;
+}
+
+// Counters behind learnSearchOrdering: a plain first-empty-cell search that records every
+// placement it tries and, at each solution, the placements on the path to it
+template <typename BoardMask>
+class OrderingStats {
+public:
+    OrderingStats(const PuzzleTables &puzzle, const std::vector<std::vector<BoardMask>> &placementMasks)
+        : puzzle(puzzle), placementMasks(placementMasks) {
+        tries.resize(puzzle.totalPieces);
+        hits.resize(puzzle.totalPieces);
+        for (int pieceIdx = 0; pieceIdx < puzzle.totalPieces; ++pieceIdx) {
+            tries[pieceIdx].assign(placementMasks[pieceIdx].size(), 0);
+            hits[pieceIdx].assign(placementMasks[pieceIdx].size(), 0);
+        }
+    }
+
+    void sample(const SearchStart<BoardMask> &start, long long nodeBudget) {
+        budget = nodeBudget;
+        usedPieces = start.usedPieces;
+        int remaining = 0;
+        for (int pieceIdx = 0; pieceIdx < puzzle.totalPieces; ++pieceIdx) remaining += usedPieces[pieceIdx] ? 0 : 1;
+        path.clear();
+        search(start.mask, remaining);
+    }
+
+    std::vector<std::vector<double>> tries;
+    std::vector<std::vector<double>> hits;
+
+private:
+    void search(const BoardMask &mask, int remaining) {
+        if (budget-- <= 0) return;
+        int cell = findFirstEmptyCell(mask, puzzle.totalCells);
+        if (cell >= puzzle.totalCells || remaining == 0) {
+            if (cell < puzzle.totalCells || remaining != 0) return;
+            for (const auto &placed : path) hits[placed.first][placed.second] += 1;
+            return;
+        }
+        for (int pieceIdx = 0; pieceIdx < puzzle.totalPieces; ++pieceIdx) {
+            if (usedPieces[pieceIdx]) continue;
+            for (int placementIdx : puzzle.piecePlacementsByCell[pieceIdx][cell]) {
+                if (masksOverlap(placementMasks[pieceIdx][placementIdx], mask)) continue;
+                tries[pieceIdx][placementIdx] += 1;
+                usedPieces[pieceIdx] = true;
+                path.push_back(std::make_pair(pieceIdx, placementIdx));
+                search(mask | placementMasks[pieceIdx][placementIdx], remaining - 1);
+                path.pop_back();
+                usedPieces[pieceIdx] = false;
+                if (budget <= 0) return;
+            }
+        }
+    }
+
+    const PuzzleTables &puzzle;
+    const std::vector<std::vector<BoardMask>> &placementMasks;
+    std::array<bool, MAX_PIECES> usedPieces;
+    std::vector<std::pair<int, int>> path;
+    long long budget = 0;
+};
+
+template <typename BoardMask>
+static bool learnWithMask(const PreparedPuzzle &prepared, const std::vector<std::string> &trainingBoards,
+                          long long nodesPerBoard, SearchOptions &options, std::string &error) {
+    const PuzzleTables &puzzle = prepared.tables;
+    OrderingStats<BoardMask> stats(puzzle, prepared.masks.get((const BoardMask *)nullptr));
+    for (const std::string &board : trainingBoards) {
+        BoardRepresentation startBoard;
+        if (!buildStartBoard(puzzle, board, startBoard, error)) return false;
+        stats.sample(startFromBoard<BoardMask>(puzzle, startBoard), nodesPerBoard);
+    }
+
+    // Success rate with one virtual try and half a hit, so untried placements sit in the middle
+    auto successRate = [](double hits, double tries) { return (hits + 0.5) / (tries + 1.0); };
+    std::vector<double> pieceRate(puzzle.totalPieces);
+    for (int pieceIdx = 0; pieceIdx < puzzle.totalPieces; ++pieceIdx) {
+        double hits = 0, tries = 0;
+        for (size_t placementIdx = 0; placementIdx < stats.tries[pieceIdx].size(); ++placementIdx) {
+            hits += stats.hits[pieceIdx][placementIdx];
+            tries += stats.tries[pieceIdx][placementIdx];
+        }
+        pieceRate[pieceIdx] = successRate(hits, tries);
+    }
+    std::vector<int> order(puzzle.totalPieces);
+    for (int pieceIdx = 0; pieceIdx < puzzle.totalPieces; ++pieceIdx) order[pieceIdx] = pieceIdx;
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return pieceRate[a] > pieceRate[b]; });
+    options.setPieceOrder(order);
+
+    options.candidateOrder = puzzle.piecePlacementsByCell;
+    for (int pieceIdx = 0; pieceIdx < puzzle.totalPieces; ++pieceIdx) {
+        auto placementRate = [&](int placementIdx) {
+            return successRate(stats.hits[pieceIdx][placementIdx], stats.tries[pieceIdx][placementIdx]);
+        };
+        for (auto &candidates : options.candidateOrder[pieceIdx]) {
+            std::stable_sort(candidates.begin(), candidates.end(), [&](int a, int b) { return placementRate(a) > placementRate(b); });
+        }
+    }
+    return true;
+}
+
+bool learnSearchOrdering(const PreparedPuzzle &prepared, const std::vector<std::string> &trainingBoards,
+                         long long nodesPerBoard, SearchOptions &options, std::string &error) {
+    if (prepared.tables.piecePlacementCells.empty()) {
+        error = "puzzle has not been prepared";
+        return false;
+    }
+    switch ((prepared.tables.totalCells + 63) / 64) {
+        case 1: return learnWithMask<uint64_t>(prepared, trainingBoards, nodesPerBoard, options, error);
+        case 2: return learnWithMask<MultiWordMask<2>>(prepared, trainingBoards, nodesPerBoard, options, error);
+        case 3: return learnWithMask<MultiWordMask<3>>(prepared, trainingBoards, nodesPerBoard, options, error);
+        default: return learnWithMask<MultiWordMask<4>>(prepared, trainingBoards, nodesPerBoard, options, error);
+    }
+}
+
+bool SolutionStream::open(const PreparedPuzzle &puzzle, const std::string &partialBoard, std::string &error) {
+    prepared = nullptr;
+    if (puzzle.tables.piecePlacementCells.empty()) {
+        error = "puzzle has not been prepared";
+        return false;
+    }
+    if (!buildStartBoard(puzzle.tables, partialBoard, startBoard, error)) return false;
+    prepared = &puzzle;
+    state = SearchState();
+    exhausted = false;
+    broken = false;
+    return true;
+}
+
+template <typename BoardMask>
+bool SolutionStream::nextWithMask(std::string &board, SolveControl *control) {
+    const PuzzleTables &puzzle = prepared->tables;
+    SearchStart<BoardMask> start = startFromBoard<BoardMask>(puzzle, startBoard);
+    const auto &placementMasks = prepared->masks.get((const BoardMask *)nullptr);
+
+    // Take one solution and stop; the state then points just past it
+    bool found = false;
+    auto takeSolution = [&](const char *solution) {
+        board.assign(solution, puzzle.totalCells);
+        found = true;
+        return false;
+    };
+    SearchStatus status;
+    do {
+        status = resumeSearch(puzzle, placementMasks, start, state, nodesPerSolveSlice, takeSolution, prepared->searchOptions);
+        if (status == SEARCH_INVALID_STATE) {
+            broken = true;
+            return false;
+        }
+        if (found) break;
+        if (status == SEARCH_PAUSED && control && control->stopRequested()) return false;
+    } while (status == SEARCH_PAUSED);
+    if (status == SEARCH_FINISHED) exhausted = true;
+    return found;
+}
+
+bool SolutionStream::next(std::string &board, SolveControl *control) {
+    if (!prepared || exhausted || broken) return false;
+    switch ((prepared->tables.totalCells + 63) / 64) {
+        case 1: return nextWithMask<uint64_t>(board, control);
+        case 2: return nextWithMask<MultiWordMask<2>>(board, control);
+        case 3: return nextWithMask<MultiWordMask<3>>(board, control);
+        default: return nextWithMask<MultiWordMask<4>>(board, control);
+    }
+}
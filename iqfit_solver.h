@@ -0,0 +1,134 @@
+// iqfit_solver.h
+// C++ API of the solver library (libiqfit): prepare a puzzle once, then solve or count
+// partial boards from any number of threads. A C wrapper for other runtimes is in iqfit_c.h.
+
+#ifndef IQFIT_SOLVER_H
+#define IQFIT_SOLVER_H
+
+#include "iqfit_core.h"
+
+#include <atomic>
+#include <functional>
+
+// Placement bitmasks for every mask width the solver dispatches to; only the width that
+// holds the board is filled
+struct PlacementMaskSet {
+    std::vector<std::vector<uint64_t>> singleWord;
+    std::vector<std::vector<MultiWordMask<2>>> twoWords;
+    std::vector<std::vector<MultiWordMask<3>>> threeWords;
+    std::vector<std::vector<MultiWordMask<4>>> fourWords;
+
+    const std::vector<std::vector<uint64_t>> &get(const uint64_t *) const { return singleWord; }
+    const std::vector<std::vector<MultiWordMask<2>>> &get(const MultiWordMask<2> *) const { return twoWords; }
+    const std::vector<std::vector<MultiWordMask<3>>> &get(const MultiWordMask<3> *) const { return threeWords; }
+    const std::vector<std::vector<MultiWordMask<4>>> &get(const MultiWordMask<4> *) const { return fourWords; }
+};
+
+// A puzzle ready to solve: its tables and placement masks are built once by preparePuzzle
+// and never modified by a solve, so one instance can be shared by concurrent solves
+struct PreparedPuzzle {
+    PuzzleTables tables;
+    PlacementMaskSet masks;
+    // How solves, hints and streams search; set before the puzzle is shared (for example
+    // searchOptions.propagate for challenge boards that already hold several pieces)
+    SearchOptions searchOptions;
+};
+
+// Build a puzzle from the text of a definition (the puzzle file format; an empty text
+// selects the standard 11x5 IQ-Fit set)
+bool preparePuzzle(const std::string &definition, PreparedPuzzle &prepared, std::string &error);
+
+// Build a puzzle from a definition file
+bool preparePuzzleFile(const std::string &path, PreparedPuzzle &prepared, std::string &error);
+
+// Lets another thread cancel a running solve; the solve stops within a few milliseconds.
+// A deadline (wallClockSeconds() value, set before the solve starts; 0 = none) stops it
+// the same way once it passes.
+struct SolveControl {
+    std::atomic<bool> cancelRequested{false};
+    double deadline = 0.0;
+
+    void cancel() { cancelRequested = true; }
+
+    bool stopRequested() const { return cancelRequested || (deadline > 0.0 && wallClockSeconds() >= deadline); }
+};
+
+struct SolveResult {
+    uint64_t solutionCount = 0;
+    uint64_t solutionDigest = 0;    // same order-independent digest the solvers print
+    bool stopped = false;           // cancelled, out of time or stopped by the callback before the search ended
+};
+
+// Receives each solution as a row-major board of totalCells characters as soon as the search
+// finds it; return false to stop
+typedef std::function<bool(const char *board)> SolutionCallback;
+
+// Solve a partial board: totalCells characters in row-major order, where '.' is an empty
+// cell, 'A'.. are pieces already placed and '#' marks a cell that stays empty. Whitespace
+// is ignored, so boards can be passed as text rows; an empty board text means an empty
+// board. Every placed piece must match one of its legal placements. onSolution may be
+// empty, and control may be null. Returns false (with error set) for an invalid board.
+bool solvePartialBoard(const PreparedPuzzle &prepared, const std::string &partialBoard,
+                       const SolutionCallback &onSolution, SolveControl *control,
+                       SolveResult &result, std::string &error);
+
+// Count the completions of a partial board without keeping the boards
+bool countSolutions(const PreparedPuzzle &prepared, const std::string &partialBoard,
+                    SolveControl *control, SolveResult &result, std::string &error);
+
+// Hint for a partial board: which placements of the remaining pieces can still lead to a
+// solution. livePlacements[piece] lists the placements (indices into the piece's
+// piecePlacementCells) that appear in at least one completion; it is empty for pieces
+// already on the board. A piece with a single live placement is forced: every completion
+// puts it there.
+struct HintResult {
+    bool solvable = false;
+    bool stopped = false;           // cancelled before the hint was complete
+    std::vector<std::vector<int>> livePlacements;
+    std::vector<std::pair<int, int>> forcedPlacements;     // (piece, placement)
+    std::string forcedBoard;        // the partial board with every forced placement added
+};
+
+// Compute a hint with one pruned search instead of enumerating every completion (same
+// partial board format as solvePartialBoard; control may be null)
+bool hintPartialBoard(const PreparedPuzzle &prepared, const std::string &partialBoard,
+                      SolveControl *control, HintResult &result, std::string &error);
+
+// Learn a search order from instrumentation: search each training board (partial boards,
+// same format as above) for at most nodesPerBoard nodes, counting how often every placement
+// is tried and how often it ends up in a solution. Placements are then tried in order of
+// their success rate at every cell, and pieces by their overall rate. Sets pieceOrder and
+// candidateOrder in options. Time to the first solution depends on this order; the number
+// of nodes a full enumeration visits does not.
+bool learnSearchOrdering(const PreparedPuzzle &prepared, const std::vector<std::string> &trainingBoards,
+                         long long nodesPerBoard, SearchOptions &options, std::string &error);
+
+// Lazy sequence of the solutions of a partial board. Each next() continues the search from
+// where the previous one stopped, so the first board arrives without searching for the
+// others and memory does not grow with the number of solutions. The prepared puzzle must
+// outlive the stream; one stream must not be used by two threads at once.
+class SolutionStream {
+public:
+    // Start a new sequence (same partial board format as solvePartialBoard)
+    bool open(const PreparedPuzzle &puzzle, const std::string &partialBoard, std::string &error);
+
+    // Next solution as a row-major board; false when there is none left, the control was
+    // cancelled or the search state turned out invalid (done() and failed() tell these
+    // apart; a cancelled stream can continue later, a failed one cannot)
+    bool next(std::string &board, SolveControl *control = nullptr);
+
+    bool done() const { return exhausted; }
+    bool failed() const { return broken; }
+
+private:
+    template <typename BoardMask>
+    bool nextWithMask(std::string &board, SolveControl *control);
+
+    const PreparedPuzzle *prepared = nullptr;
+    BoardRepresentation startBoard;
+    SearchState state;
+    bool exhausted = false;
+    bool broken = false;
+};
+
+#endif // IQFIT_SOLVER_H
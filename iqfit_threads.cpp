@@ -0,0 +1,315 @@
+// iqfit_threads.cpp
+// Standalone IQ-Fit solver for machines without MPI: std::thread workers take the place of
+// MPI ranks. Thread t explores first-piece placements t, t+T, t+2T, ... exactly like rank t
+// of "mpirun -np T", so solutions.txt, the totals and the digest match the MPI solver, and
+// checkpoints written by either solver can be resumed by the other with the same count.
+
+#include "iqfit_core.h"
+#include "iqfit_checkpoint.h"
+#include "iqfit_distributed.h"
+#include "iqfit_analytics.h"
+#include "iqfit_profile.h"
+#include "iqfit_affinity.h"
+#include "iqfit_compress.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+int main(int argc, char **argv) {
+    // Same options as the MPI solver; --threads replaces mpirun -np (0 = one per hardware thread)
+    int totalThreads = 0;
+    std::string puzzlePath;
+    PuzzleTables puzzle;
+    CheckpointOptions checkpoints;
+    LeaseOptions leases;
+    std::string coordinatorAddress, workerAddress, analyticsPrefix, subsetCountsPath;
+    size_t subsetMemoLimit = 20000000;
+    bool profileCount = false;
+    bool compressOutput = false;
+    PinMode pinMode = PIN_NONE;
+    int numaNodes = 0;
+    int firstLength = 0, lastLength = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            totalThreads = std::atoi(argv[++i]);
+        } else if (arg == "--puzzle" && i + 1 < argc) {
+            puzzlePath = argv[++i];
+        } else if (arg == "--checkpoint-dir" && i + 1 < argc) {
+            checkpoints.directory = argv[++i];
+        } else if (arg == "--checkpoint-interval" && i + 1 < argc) {
+            checkpoints.intervalSeconds = std::atof(argv[++i]);
+        } else if (arg == "--checkpoint-solutions") {
+            checkpoints.flushSolutions = true;
+        } else if (arg == "--restart") {
+            checkpoints.restart = true;
+        } else if (arg == "--coordinator" && i + 1 < argc) {
+            coordinatorAddress = argv[++i];
+        } else if (arg == "--worker" && i + 1 < argc) {
+            workerAddress = argv[++i];
+        } else if (arg == "--lease-timeout" && i + 1 < argc) {
+            leases.leaseSeconds = std::atof(argv[++i]);
+        } else if (arg == "--heartbeat-interval" && i + 1 < argc) {
+            leases.heartbeatSeconds = std::atof(argv[++i]);
+        } else if (arg == "--analytics" && i + 1 < argc) {
+            analyticsPrefix = argv[++i];
+        } else if (arg == "--subset-counts" && i + 1 < argc) {
+            subsetCountsPath = argv[++i];
+        } else if (arg == "--subset-memo-limit" && i + 1 < argc) {
+            subsetMemoLimit = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--pin" && i + 1 < argc && parsePinMode(argv[i + 1], pinMode)) {
+            ++i;
+        } else if (arg == "--numa-nodes" && i + 1 < argc) {
+            numaNodes = std::atoi(argv[++i]);
+        } else if (arg == "--compress") {
+            compressOutput = true;
+        } else if (arg == "--profile-count") {
+            profileCount = true;
+        } else if (arg == "--lengths" && i + 1 < argc) {
+            std::string range = argv[++i];
+            size_t dash = range.find('-');
+            firstLength = std::atoi(range.c_str());
+            lastLength = dash == std::string::npos ? firstLength : std::atoi(range.c_str() + dash + 1);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--threads <count>] [--puzzle <file>] [--checkpoint-dir <dir>]"
+                      << " [--checkpoint-interval <seconds>] [--checkpoint-solutions] [--restart]\n"
+                      << "       [--coordinator <addr> | --worker <addr>]"
+                      << " [--lease-timeout <seconds>] [--heartbeat-interval <seconds>]\n"
+                      << "       [--pin none|cores|numa] [--numa-nodes <count>] [--compress]\n"
+                      << "       [--analytics <prefix> | --subset-counts <csv> [--subset-memo-limit <records>]"
+                      << " | --profile-count [--lengths <from>-<to>]]\n"
+                      << "  <addr> is unix:<path> or <host>:<port>\n";
+            return 1;
+        }
+    }
+    if (totalThreads <= 0) totalThreads = std::max(1u, std::thread::hardware_concurrency());
+    if (checkpoints.restart && checkpoints.directory.empty()) {
+        std::cerr << "Error: --restart needs --checkpoint-dir\n";
+        return 1;
+    }
+    if (!checkpoints.directory.empty() && (!coordinatorAddress.empty() || !workerAddress.empty())) {
+        std::cerr << "Error: --checkpoint-dir cannot be combined with dynamic or socket distribution\n";
+        return 1;
+    }
+    if ((!analyticsPrefix.empty() || !subsetCountsPath.empty() || profileCount) && (!checkpoints.directory.empty() || !coordinatorAddress.empty() || !workerAddress.empty())) {
+        std::cerr << "Error: --analytics, --subset-counts and --profile-count cannot be combined with checkpoints or socket distribution\n";
+        return 1;
+    }
+    if (compressOutput && (!coordinatorAddress.empty() || !workerAddress.empty() || !analyticsPrefix.empty() ||
+                           !subsetCountsPath.empty() || profileCount)) {
+        std::cerr << "Error: --compress only applies to the search that writes solutions.txt\n";
+        return 1;
+    }
+    if (!puzzlePath.empty()) {
+        std::string error;
+        if (!loadPuzzleDefinition(puzzlePath, puzzle, error)) {
+            std::cerr << "Error: " << error << "\n";
+            return 1;
+        }
+    }
+
+    double startTime = wallClockSeconds();
+    precomputeAllPiecePlacements(puzzle);
+
+    std::string mismatch = describePieceAreaMismatch(puzzle);
+    if (!mismatch.empty() && subsetCountsPath.empty() && !profileCount) std::cerr << "Warning: " << mismatch << "\n";
+
+    // Socket distribution: this process is either the coordinator or one worker
+    if (!workerAddress.empty()) {
+        return runSocketWorker(puzzle, workerAddress, leases) ? 0 : 1;
+    }
+    if (!coordinatorAddress.empty()) {
+        if (!runSocketCoordinator(puzzle, coordinatorAddress, leases)) return 1;
+        std::cout << "Elapsed time: " << (wallClockSeconds() - startTime) << " seconds\n";
+        return 0;
+    }
+
+    // Analytics: each thread counts into its own arrays, merged at the end; no board is stored
+    if (!analyticsPrefix.empty()) {
+        std::vector<SolutionAnalytics> threadAnalytics(totalThreads, SolutionAnalytics(puzzle));
+        std::vector<std::thread> workers;
+        for (int t = 0; t < totalThreads; ++t) {
+            workers.emplace_back([&, t]() { analyzeAssignedPlacementsForBoard(puzzle, t, totalThreads, threadAnalytics[t]); });
+        }
+        for (auto &worker : workers) worker.join();
+        for (int t = 1; t < totalThreads; ++t) threadAnalytics[0].merge(threadAnalytics[t]);
+        std::string error;
+        if (!threadAnalytics[0].writeReports(analyticsPrefix, error)) {
+            std::cerr << "Error: " << error << "\n";
+            return 1;
+        }
+        printSolutionTotals(threadAnalytics[0].solutionCount(), threadAnalytics[0].solutionDigest());
+        std::cout << "Analytics written to " << analyticsPrefix << ".json and " << analyticsPrefix << "_*.csv\n";
+        std::cout << "Elapsed time: " << (wallClockSeconds() - startTime) << " seconds\n";
+        return 0;
+    }
+
+    // Tiling counts for every piece subset over the puzzle's open cells (one shared memo, so
+    // this runs on the calling thread)
+    if (!subsetCountsPath.empty()) {
+        size_t memoRecords = 0;
+        std::vector<SubsetCount> counts;
+        std::string error;
+        if (!countTilingsBySubset(puzzle, subsetMemoLimit, counts, memoRecords, error) ||
+            !writeSubsetCounts(subsetCountsPath, puzzle, counts, error)) {
+            std::cerr << "Error: " << error << "\n";
+            return 1;
+        }
+        unsigned long long fullSetTilings = 0;
+        uint32_t fullSet = (1u << puzzle.totalPieces) - 1;
+        if (!counts.empty() && counts.back().pieces == fullSet) fullSetTilings = counts.back().tilings;
+        std::cout << "Subsets that tile the board: " << counts.size() << " of " << (1ULL << puzzle.totalPieces)
+                  << " (" << memoRecords << " memo records)\n";
+        std::cout << "Tilings with every piece: " << fullSetTilings << "\n";
+        std::cout << "Subset counts written to " << subsetCountsPath << "\n";
+        std::cout << "Elapsed time: " << (wallClockSeconds() - startTime) << " seconds\n";
+        return 0;
+    }
+
+    // Exact counts from the column-profile DP, for the puzzle's board or for a range of widths
+    // with the same height and pieces
+    if (profileCount) {
+        if (firstLength <= 0) firstLength = lastLength = puzzle.boardWidth;
+        if (firstLength != puzzle.boardWidth || lastLength != puzzle.boardWidth) {
+            if (!puzzle.blockedCells.empty()) {
+                std::cerr << "Error: --lengths needs a board without blocked cells\n";
+                return 1;
+            }
+        }
+        std::cout << "Board      Every piece     Any subset   Peak states   Seconds\n";
+        for (int length = firstLength; length <= lastLength; ++length) {
+            PuzzleTables sized = puzzle;
+            if (length != puzzle.boardWidth) {
+                sized.boardWidth = length;
+                sized.totalCells = length * sized.boardHeight;
+                precomputeAllPiecePlacements(sized);
+            }
+            double lengthStart = wallClockSeconds();
+            ProfileCount counts;
+            std::string error;
+            if (!countByProfile(sized, totalThreads, counts, error)) {
+                std::cerr << "Error: " << error << "\n";
+                return 1;
+            }
+            char line[128];
+            std::snprintf(line, sizeof(line), "%3dx%-3d %14llu %14llu %13zu %9.3f\n", sized.boardWidth, sized.boardHeight,
+                          counts.allPieces, counts.anySubset, counts.peakStates, wallClockSeconds() - lengthStart);
+            std::cout << line;
+        }
+        std::cout << "Elapsed time: " << (wallClockSeconds() - startTime) << " seconds\n";
+        return 0;
+    }
+
+    // Resume each thread's checkpoint before starting, so restore messages are not interleaved
+    std::vector<RankProgress> progress(totalThreads);
+    std::vector<std::vector<char>> localBuffers(totalThreads);
+    if (!checkpoints.directory.empty()) {
+        installPreemptHandlers();
+        for (int t = 0; t < totalThreads; ++t) {
+            prepareRankCheckpoint(puzzle, checkpoints, t, totalThreads, progress[t], localBuffers[t]);
+        }
+    }
+
+    // Pinned threads: report the mapping and, with several NUMA nodes, give every node its own
+    // copy of the tables, made by a thread on that node so its pages are local (first touch)
+    NumaTopology topology;
+    std::vector<WorkerPlacement> placements(totalThreads);
+    std::vector<PuzzleTables> nodeTables;
+    if (pinMode != PIN_NONE) {
+        topology = discoverTopology(numaNodes);
+        std::cout << "Topology: " << describeTopology(topology) << "\n";
+        for (int t = 0; t < totalThreads; ++t) {
+            placements[t] = placeWorker(topology, pinMode, t);
+            std::cout << "Thread " << t << ": " << describePlacement(topology, placements[t]) << "\n";
+        }
+        if (topology.nodeIds.size() > 1) {
+            nodeTables.resize(topology.nodeIds.size());
+            std::vector<std::thread> copiers;
+            for (size_t n = 0; n < nodeTables.size(); ++n) {
+                copiers.emplace_back([&, n]() {
+                    std::string error;
+                    pinCurrentThread(placeWorker(topology, PIN_NUMA, n), error);
+                    nodeTables[n] = puzzle;
+                });
+            }
+            for (auto &copier : copiers) copier.join();
+        }
+    }
+
+    // Placement tables are read-only from here on, so the threads share them (one copy per node
+    // when pinned across several nodes)
+    std::vector<SearchStatus> statuses(totalThreads, SEARCH_FINISHED);
+    std::vector<size_t> boardCounts(totalThreads, 0);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < totalThreads; ++t) {
+        workers.emplace_back([&, t]() {
+            std::string error;
+            if (!pinCurrentThread(placements[t], error)) std::cerr << "Warning: thread " << t << ": " << error << "\n";
+            const PuzzleTables &tables = nodeTables.empty() ? puzzle : nodeTables[placements[t].node];
+            statuses[t] = searchAssignedPlacementsForBoard(tables, t, totalThreads, checkpoints, progress[t], localBuffers[t]);
+            boardCounts[t] = localBuffers[t].size() / puzzle.totalCells;
+            // Each thread compresses its own boards; the blocks are concatenated in thread order
+            if (compressOutput && statuses[t] == SEARCH_FINISHED) {
+                std::vector<char> compressed;
+                if (!compressSolutions(tables, localBuffers[t].data(), boardCounts[t], compressed, error)) {
+                    std::cerr << "Error: thread " << t << ": " << error << "\n";
+                    statuses[t] = SEARCH_INVALID_STATE;
+                }
+                localBuffers[t].swap(compressed);
+            }
+        });
+    }
+    for (auto &worker : workers) worker.join();
+
+    bool anyPreempted = false;
+    for (SearchStatus status : statuses) {
+        if (status == SEARCH_INVALID_STATE) return 1;
+        if (status == SEARCH_PAUSED) anyPreempted = true;
+    }
+    // A preempted thread has saved its exact position; stop without writing output
+    if (anyPreempted) {
+        std::cout << "Preempted: progress saved in " << checkpoints.directory << "; resume with --restart\n";
+        return 0;
+    }
+
+    // Totals and digests include boards found before a restart, even if they were not flushed
+    unsigned long long totalSolutions = 0, digest = 0;
+    for (const auto &threadProgress : progress) {
+        totalSolutions += threadProgress.solutionCount;
+        digest += threadProgress.solutionDigest;
+    }
+
+    // Boards are written thread by thread, in the same order as the MPI solver's ranks
+    const char *outputPath = compressOutput ? "solutions.iqz" : "solutions.txt";
+    std::ofstream outputFile(outputPath, std::ios::binary);
+    if (!outputFile.is_open()) {
+        std::cerr << "Error: Could not open " << outputPath << "\n";
+    } else {
+        unsigned long long boardsWritten = 0;
+        if (compressOutput) {
+            std::vector<char> header;
+            appendCompressedHeader(puzzle, header);
+            outputFile.write(header.data(), header.size());
+        }
+        for (int t = 0; t < totalThreads; ++t) {
+            if (compressOutput) {
+                outputFile.write(localBuffers[t].data(), localBuffers[t].size());
+            } else {
+                writeBoardsAsText(outputFile, puzzle, localBuffers[t].data(), boardCounts[t]);
+            }
+            boardsWritten += boardCounts[t];
+        }
+        outputFile.close();
+        if (boardsWritten != totalSolutions) {
+            std::cerr << "Warning: " << outputPath << " holds " << boardsWritten << " of " << totalSolutions
+                      << " solutions (boards found before the restart were not flushed)\n";
+        }
+        printSolutionTotals(totalSolutions, digest);
+    }
+    std::cout << "Elapsed time: " << (wallClockSeconds() - startTime) << " seconds\n";
+    return 0;
+}
@@ -0,0 +1,72 @@
+// iqfit_unpack.cpp
+// Decodes a compressed solution file (solutions.iqz, written with --compress) back into the
+// solutions.txt text, one block at a time, and prints the totals and digest of the boards.
+// The puzzle must be the one the file was written for (checked against its fingerprint).
+
+#include "iqfit_core.h"
+#include "iqfit_compress.h"
+#include "iqfit_output.h"
+#include <iostream>
+#include <string>
+
+int main(int argc, char **argv) {
+    std::string puzzlePath, inputPath, outputPath = "solutions.txt";
+    int positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--puzzle" && i + 1 < argc) {
+            puzzlePath = argv[++i];
+        } else if (arg[0] != '-' && positional == 0) {
+            inputPath = arg;
+            ++positional;
+        } else if (arg[0] != '-' && positional == 1) {
+            outputPath = arg;
+            ++positional;
+        } else {
+            inputPath.clear();
+            break;
+        }
+    }
+    if (inputPath.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [--puzzle <file>] <solutions.iqz> [<solutions.txt>]\n";
+        return 1;
+    }
+
+    PuzzleTables puzzle;
+    std::string error;
+    if (!puzzlePath.empty() && !loadPuzzleDefinition(puzzlePath, puzzle, error)) {
+        std::cerr << "Error: " << error << "\n";
+        return 1;
+    }
+    double startTime = wallClockSeconds();
+    precomputeAllPiecePlacements(puzzle);
+
+    CompressedSolutionReader reader(puzzle);
+    if (!reader.open(inputPath, error)) {
+        std::cerr << "Error: " << error << "\n";
+        return 1;
+    }
+    BlockWriter output(puzzle);
+    if (!output.open(outputPath, false, error)) {
+        std::cerr << "Error: " << error << "\n";
+        return 1;
+    }
+    unsigned long long digest = 0;
+    const char *board;
+    while (reader.next(board)) {
+        output.appendBoards(board, 1);
+        digest += digestSolutions(puzzle, board, 1);
+    }
+    bool closed = output.close(error);
+    if (!reader.error().empty()) {
+        std::cerr << "Error: " << inputPath << ": " << reader.error() << "\n";
+        return 1;
+    }
+    if (!closed) {
+        std::cerr << "Error: " << outputPath << ": " << error << "\n";
+        return 1;
+    }
+    printSolutionTotals(output.boardCount(), digest);
+    std::cout << "Elapsed time: " << (wallClockSeconds() - startTime) << " seconds\n";
+    return 0;
+}
@@ -0,0 +1,249 @@
+// iqfit_validate.cpp
+// Placement lookup by cell mask and the memory-mapped, multi-threaded solutions file check.
+
+#include "iqfit_validate.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+constexpr size_t MAX_REPORTED_PROBLEMS = 10;
+
+// Unused high words are zero, so mixing them in costs little and keeps one key type
+size_t PlacementLookup::MaskHash::operator()(const CellMask &mask) const {
+    uint64_t hash = mask.words[0];
+    for (int w = 1; w < 4; ++w) hash = (hash ^ (hash >> 29)) * 0xbf58476d1ce4e5b9ULL + mask.words[w];
+    hash ^= hash >> 32;
+    hash *= 0x94d049bb133111ebULL;
+    return hash ^ (hash >> 29);
+}
+
+PlacementLookup::PlacementLookup(const PuzzleTables &puzzle)
+    : puzzle(puzzle), placementByMask(puzzle.totalPieces), blocked(puzzle.totalCells, false) {
+    for (int p = 0; p < puzzle.totalPieces; ++p) {
+        const auto &placements = puzzle.piecePlacementCells[p];
+        placementByMask[p].reserve(placements.size());
+        for (size_t i = 0; i < placements.size(); ++i) {
+            CellMask mask = CellMask();
+            for (int cell : placements[i]) occupyCell(mask, cell);
+            placementByMask[p].emplace(mask, i);
+        }
+    }
+    for (int cell : puzzle.blockedCells) blocked[cell] = true;
+}
+
+bool PlacementLookup::placementsOf(const char *board, std::vector<int> &placements, std::string &reason) const {
+    std::array<CellMask, MAX_PIECES> pieceMasks;
+    std::fill(pieceMasks.begin(), pieceMasks.begin() + puzzle.totalPieces, CellMask());
+    for (int cell = 0; cell < puzzle.totalCells; ++cell) {
+        char c = board[cell];
+        if (blocked[cell]) {
+            if (c == '#') continue;
+            reason = "blocked cell " + std::to_string(cell) + " holds '" + std::string(1, c) + "'";
+            return false;
+        }
+        int p = c - 'A';
+        if (p < 0 || p >= puzzle.totalPieces) {
+            reason = "cell " + std::to_string(cell) + " holds '" + std::string(1, c) + "', not a piece";
+            return false;
+        }
+        occupyCell(pieceMasks[p], cell);
+    }
+    placements.resize(puzzle.totalPieces);
+    for (int p = 0; p < puzzle.totalPieces; ++p) {
+        auto found = placementByMask[p].find(pieceMasks[p]);
+        if (found == placementByMask[p].end()) {
+            bool missing = std::all_of(pieceMasks[p].words.begin(), pieceMasks[p].words.end(), [](uint64_t word) { return word == 0; });
+            reason = std::string("piece '") + char('A' + p) + (missing ? "' is missing" : "' is not one of its placements");
+            return false;
+        }
+        placements[p] = found->second;
+    }
+    return true;
+}
+
+using BoardHash = std::pair<uint64_t, size_t>;     // (board hash, byte offset of the board)
+
+// Boards of one chunk: board hashes for the duplicate check, split by hash range so each
+// thread later checks one range, and the first few problems
+struct ChunkResult {
+    unsigned long long boards = 0, invalidBoards = 0, validDigest = 0;
+    std::vector<std::vector<BoardHash>> hashRanges;
+    std::vector<std::pair<size_t, std::string>> problems;
+};
+
+// Boards start in [begin, end); the last one may run past end
+static void validateChunk(const PuzzleTables &puzzle, const PlacementLookup &lookup, const char *data, size_t size,
+                          size_t begin, size_t end, ChunkResult &result) {
+    const size_t width = puzzle.boardWidth;
+    BoardRepresentation board(puzzle.totalCells);
+    std::vector<int> placements;
+    std::string reason;
+    size_t pos = begin;
+    while (pos < end) {
+        if (data[pos] == '\n') {
+            ++pos;
+            continue;
+        }
+        size_t boardStart = pos;
+        bool wellFormed = true;
+        for (int row = 0; row < puzzle.boardHeight && wellFormed; ++row) {
+            size_t lineEnd = pos + width;
+            wellFormed = lineEnd <= size && std::memchr(data + pos, '\n', width) == nullptr &&
+                         (lineEnd == size || data[lineEnd] == '\n');
+            if (wellFormed) {
+                std::memcpy(&board[row * width], data + pos, width);
+                pos = lineEnd + 1;
+            }
+        }
+        ++result.boards;
+        if (!wellFormed) {
+            // Resynchronize at the next blank line
+            ++result.invalidBoards;
+            if (result.problems.size() < MAX_REPORTED_PROBLEMS) {
+                result.problems.emplace_back(boardStart, "malformed board (expected " + std::to_string(puzzle.boardHeight) +
+                                                             " rows of " + std::to_string(width) + " characters)");
+            }
+            const char *blank = static_cast<const char *>(memmem(data + boardStart, size - boardStart, "\n\n", 2));
+            pos = blank ? blank - data + 2 : size;
+            continue;
+        }
+        if (lookup.placementsOf(board.data(), placements, reason)) {
+            // Only solutions take part in the duplicate check
+            uint64_t hash = fnv1aHash(board.data(), puzzle.totalCells);
+            result.hashRanges[(hash >> 32) * result.hashRanges.size() >> 32].emplace_back(hash, boardStart);
+            result.validDigest += hash;
+        } else {
+            ++result.invalidBoards;
+            if (result.problems.size() < MAX_REPORTED_PROBLEMS) result.problems.emplace_back(boardStart, reason);
+        }
+    }
+}
+
+// Two well-formed boards at these offsets hold the same cells
+static bool sameBoard(const PuzzleTables &puzzle, const char *data, size_t a, size_t b) {
+    for (int row = 0; row < puzzle.boardHeight; ++row) {
+        size_t rowOffset = row * (puzzle.boardWidth + 1);
+        if (std::memcmp(data + a + rowOffset, data + b + rowOffset, puzzle.boardWidth) != 0) return false;
+    }
+    return true;
+}
+
+// Open-addressing set of the boards seen so far. A slot holds the high half of the board's
+// hash and its index into hashes (8 bytes), so most probes stay in the table; equal hashes
+// are confirmed on the text. The hashes of the repeats are added to repeatDigest.
+static unsigned long long countDuplicates(const PuzzleTables &puzzle, const char *data, const std::vector<BoardHash> &hashes,
+                                          uint64_t &repeatDigest) {
+    const uint64_t EMPTY = ~0ULL;
+    size_t slots = 16;
+    while (slots < 2 * hashes.size()) slots *= 2;
+    std::vector<uint64_t> table(slots, EMPTY);
+    unsigned long long duplicates = 0;
+    for (uint32_t i = 0; i < hashes.size(); ++i) {
+        uint64_t hash = hashes[i].first, entry = (hash & 0xFFFFFFFF00000000ULL) | i;
+        for (size_t slot = hash & (slots - 1);; slot = (slot + 1) & (slots - 1)) {
+            uint64_t seen = table[slot];
+            if (seen == EMPTY) {
+                table[slot] = entry;
+                break;
+            }
+            const BoardHash &other = hashes[uint32_t(seen)];
+            if ((seen >> 32) == (hash >> 32) && other.first == hash && sameBoard(puzzle, data, other.second, hashes[i].second)) {
+                ++duplicates;
+                repeatDigest += hash;
+                break;
+            }
+        }
+    }
+    return duplicates;
+}
+
+bool validateSolutionsFile(const PuzzleTables &puzzle, const std::string &path, int threads,
+                           ValidationReport &report, std::string &error) {
+    report = ValidationReport();
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat status;
+    if (fd < 0 || fstat(fd, &status) != 0) {
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        if (fd >= 0) close(fd);
+        return false;
+    }
+    size_t size = status.st_size;
+    if (size == 0) {
+        close(fd);
+        return true;
+    }
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        error = "cannot map " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    const char *data = static_cast<const char *>(mapping);
+
+    // Chunk boundaries just after a blank line, so no board is split between threads
+    threads = std::max(1, threads);
+    std::vector<size_t> bounds(threads + 1, size);
+    bounds[0] = 0;
+    for (int t = 1; t < threads; ++t) {
+        size_t from = std::max(bounds[t - 1], size * t / threads);
+        from = from > 0 ? from - 1 : 0;
+        const void *blank = from < size ? memmem(data + from, size - from, "\n\n", 2) : nullptr;
+        bounds[t] = blank ? static_cast<const char *>(blank) - data + 2 : size;
+    }
+
+    PlacementLookup lookup(puzzle);
+    std::vector<ChunkResult> results(threads);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            results[t].hashRanges.resize(threads);
+            validateChunk(puzzle, lookup, data, size, bounds[t], bounds[t + 1], results[t]);
+        });
+    }
+    for (auto &worker : workers) worker.join();
+
+    // Second pass: thread t gathers hash range t from every chunk and counts its duplicates
+    std::vector<unsigned long long> duplicates(threads, 0);
+    std::vector<uint64_t> repeatDigests(threads, 0);
+    workers.clear();
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            std::vector<BoardHash> hashes;
+            for (ChunkResult &result : results) {
+                hashes.insert(hashes.end(), result.hashRanges[t].begin(), result.hashRanges[t].end());
+                std::vector<BoardHash>().swap(result.hashRanges[t]);
+            }
+            duplicates[t] = countDuplicates(puzzle, data, hashes, repeatDigests[t]);
+        });
+    }
+    for (auto &worker : workers) worker.join();
+
+    std::vector<std::pair<size_t, std::string>> problems;
+    for (int t = 0; t < threads; ++t) {
+        report.boards += results[t].boards;
+        report.invalidBoards += results[t].invalidBoards;
+        report.validDigest += results[t].validDigest - repeatDigests[t];
+        report.duplicateBoards += duplicates[t];
+        problems.insert(problems.end(), results[t].problems.begin(), results[t].problems.end());
+    }
+
+    // Problems are in file order already (chunks are); turn their offsets into line numbers
+    if (problems.size() > MAX_REPORTED_PROBLEMS) problems.resize(MAX_REPORTED_PROBLEMS);
+    size_t counted = 0;
+    unsigned long long line = 1;
+    for (const auto &problem : problems) {
+        line += std::count(data + counted, data + problem.first, '\n');
+        counted = problem.first;
+        report.problems.push_back("line " + std::to_string(line) + ": " + problem.second);
+    }
+    munmap(mapping, size);
+    return true;
+}
@@ -0,0 +1,57 @@
+// iqfit_validate.h
+// Checking solutions files written by the solvers. The file is memory-mapped and split into
+// one chunk per thread at blank-line boundaries. Every thread parses its boards and rebuilds
+// the cell mask of each piece letter, then looks the mask up among that piece's placements.
+// A board is a solution when every piece matches one of its placements and every open cell
+// is covered. The hashes of the valid boards (the same FNV-1a hashes as the solution digest)
+// are then partitioned by value to find duplicates.
+
+#ifndef IQFIT_VALIDATE_H
+#define IQFIT_VALIDATE_H
+
+#include "iqfit_core.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Placement behind each piece letter of a board, found by hashing the piece's cell mask
+class PlacementLookup {
+public:
+    explicit PlacementLookup(const PuzzleTables &puzzle);
+
+    // Placement index (into piecePlacementCells) of every piece on a complete board; false with
+    // the reason when the board is not a solution
+    bool placementsOf(const char *board, std::vector<int> &placements, std::string &reason) const;
+
+private:
+    // Wide enough for every supported board, so one key type serves all of them
+    using CellMask = MultiWordMask<4>;
+    struct MaskHash {
+        size_t operator()(const CellMask &mask) const;
+    };
+    struct MaskEqual {
+        bool operator()(const CellMask &a, const CellMask &b) const { return a.words == b.words; }
+    };
+
+    const PuzzleTables &puzzle;
+    std::vector<std::unordered_map<CellMask, int, MaskHash, MaskEqual>> placementByMask;
+    std::vector<bool> blocked;
+};
+
+struct ValidationReport {
+    unsigned long long boards = 0;          // boards in the file
+    unsigned long long invalidBoards = 0;   // boards that are not solutions (or are malformed)
+    unsigned long long duplicateBoards = 0; // repeats of an earlier valid board
+    unsigned long long validDigest = 0;     // solution digest of the distinct valid boards
+    std::vector<std::string> problems;      // the first few problems, with line numbers
+
+    // Distinct solutions in the file (what the solver's total counts)
+    unsigned long long distinctBoards() const { return boards - invalidBoards - duplicateBoards; }
+};
+
+// Validate a solutions.txt-style file with the given number of threads
+bool validateSolutionsFile(const PuzzleTables &puzzle, const std::string &path, int threads,
+                           ValidationReport &report, std::string &error);
+
+#endif // IQFIT_VALIDATE_H